@@ -0,0 +1,52 @@
+#include "bench.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+
+namespace bench
+{
+    Runner::Runner(std::ostream &out, const std::string &filter, double minTime)
+        : mOut(out)
+        , mFilter(filter)
+        , mMinTime(minTime)
+        , mNumRun(0)
+    {
+        mOut << std::left << std::setw(40) << "Benchmark"
+             << std::right << std::setw(12) << "Iterations"
+             << std::setw(16) << "Time/op, ns"
+             << std::endl;
+    }
+
+    bool Runner::Selected(const std::string &name) const
+    {
+        return name.find(mFilter) != std::string::npos;
+    }
+
+    size_t Runner::NumRun() const
+    {
+        return mNumRun;
+    }
+
+    void Runner::Metric(const std::string &name, double value, const std::string &unit)
+    {
+        if(!Selected(name)) {
+            return;
+        }
+
+        mOut << std::left << std::setw(40) << name
+             << std::right << std::setw(12) << ""
+             << std::setw(16) << std::fixed << std::setprecision(1) << value
+             << ' ' << unit
+             << std::endl;
+    }
+
+    void Runner::Report(const std::string &name, size_t iterations, double seconds)
+    {
+        ++mNumRun;
+        mOut << std::left << std::setw(40) << name
+             << std::right << std::setw(12) << iterations
+             << std::setw(16) << std::fixed << std::setprecision(1) << (seconds * 1e9 / iterations)
+             << std::endl;
+    }
+}
@@ -0,0 +1,76 @@
+#ifndef BENCH_H_
+#define BENCH_H_
+
+#include <algorithm>
+#include <chrono>
+#include <iosfwd>
+#include <string>
+
+namespace bench
+{
+    /**
+       \brief Tiny timing harness.
+
+       Each benchmark is a callable which performs a single operation.
+       It is run in batches of growing size until the batch takes at least
+       the minimum time, then time per operation of the last batch is reported.
+    **/
+    class Runner
+    {
+        typedef std::chrono::steady_clock clock_t;
+
+        std::ostream &mOut;
+        std::string mFilter;
+        std::chrono::duration<double> mMinTime;
+        size_t mNumRun;
+
+        void Report(const std::string &name, size_t iterations, double seconds);
+
+    public:
+        Runner(std::ostream &out, const std::string &filter, double minTime);
+
+        bool Selected(const std::string &name) const;
+
+        /**
+           \brief Reports a value which is not a time, e.g. an output size.
+        **/
+        void Metric(const std::string &name, double value, const std::string &unit);
+        size_t NumRun() const;
+
+        template<class Func>
+        void Run(const std::string &name, Func func);
+    };
+
+    template<class Func>
+    void Runner::Run(const std::string &name, Func func)
+    {
+        if(!Selected(name)) {
+            return;
+        }
+
+        // Warm up caches and lazily initialized stuff
+        func();
+
+        size_t iterations = 1;
+        while(true) {
+            const clock_t::time_point start = clock_t::now();
+            for(size_t i = 0; i < iterations; ++i) {
+                func();
+            }
+            const std::chrono::duration<double> elapsed = clock_t::now() - start;
+
+            if(elapsed >= mMinTime) {
+                Report(name, iterations, elapsed.count());
+                return;
+            }
+
+            // Aim a bit higher than the minimum time to avoid an extra round
+            const double scale = (elapsed.count() > 0)
+                ? 1.4 * mMinTime.count() / elapsed.count()
+                : 10.0;
+            iterations = std::max<size_t>(iterations + 1, iterations * std::min(scale, 10.0));
+        }
+    }
+}
+
+#endif // BENCH_H_
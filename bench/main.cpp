@@ -0,0 +1,236 @@
+#include <cstdlib>
+
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem/operations.hpp>
+#include <boost/program_options/variables_map.hpp>
+#include <boost/program_options/parsers.hpp>
+#include <boost/program_options/options_description.hpp>
+
+#include <core/color.h>
+#include <core/image.h>
+#include <core/imageblur.h>
+#include <core/imagetransform.h>
+#include <core/palette.h>
+#include <core/point.h>
+#include <core/rect.h>
+#include <core/rlesprite.h>
+
+#include <gm1/gm1.h>
+#include <gm1/gm1reader.h>
+
+#include <tgx/tgx.h>
+
+#include <bench/bench.h>
+#include <bench/synthetic.h>
+
+namespace po = boost::program_options;
+namespace fs = boost::filesystem;
+
+namespace
+{
+    const size_t ImageSize = 256;
+    const size_t NumCollectionEntries = 64;
+
+    /**
+       \brief Temporary directory which is removed with all its content.
+    **/
+    class TempDir
+    {
+        fs::path mPath;
+
+    public:
+        TempDir()
+            : mPath(fs::temp_directory_path() / fs::unique_path("castle-bench-%%%%-%%%%"))
+        {
+            fs::create_directories(mPath);
+        }
+
+        ~TempDir()
+        {
+            boost::system::error_code ignored;
+            fs::remove_all(mPath, ignored);
+        }
+
+        const fs::path& Path() const
+        {
+            return mPath;
+        }
+    };
+
+    struct Collection
+    {
+        std::string name;
+        gm1::ArchiveType type;
+    };
+
+    void RunTGX(bench::Runner &runner, const core::Palette &palette)
+    {
+        core::Image image = core::ConvertImage(bench::CreateSprite(ImageSize, ImageSize, palette, 0), SDL_PIXELFORMAT_RGB555);
+        image.SetColorKey(core::Color(255, 0, 255));
+
+        std::ostringstream oss;
+        tgx::EncodeImage(oss, image);
+        const std::string encoded = oss.str();
+
+        std::ostringstream optimal;
+        tgx::EncodeImage(optimal, image, tgx::Encoding::Optimal);
+
+        runner.Metric("tgx/EncodedSize", encoded.size(), "bytes");
+        runner.Metric("tgx/EncodedSize(Optimal)", optimal.str().size(), "bytes");
+
+        runner.Run("tgx/EncodeImage", [&image]() {
+                std::ostringstream out;
+                tgx::EncodeImage(out, image);
+            });
+
+        runner.Run("tgx/EncodeImage(Optimal)", [&image]() {
+                std::ostringstream out;
+                tgx::EncodeImage(out, image, tgx::Encoding::Optimal);
+            });
+
+        core::Image target = core::CreateImage(ImageSize, ImageSize, SDL_PIXELFORMAT_RGB555);
+        runner.Run("tgx/DecodeImage", [&encoded, &target]() {
+                tgx::DecodeImage(encoded.data(), encoded.size(), target);
+            });
+
+        runner.Run("tgx/DecodeSprite", [&encoded]() {
+                tgx::DecodeSprite(encoded.data(), encoded.size(), ImageSize, ImageSize, SDL_PIXELFORMAT_RGB555);
+            });
+    }
+
+    void RunGM1(bench::Runner &runner, const fs::path &dir)
+    {
+        const std::vector<Collection> collections = {
+            {"tgx16",   gm1::ArchiveType::TGX16},
+            {"tgx8",    gm1::ArchiveType::TGX8},
+            {"tile",    gm1::ArchiveType::TileObject},
+            {"font",    gm1::ArchiveType::Font},
+            {"bitmap",  gm1::ArchiveType::Bitmap}
+        };
+
+        for(const Collection &collection : collections) {
+            const std::string prefix = "gm1/" + collection.name;
+            if(!runner.Selected(prefix)) {
+                continue;
+            }
+
+            const fs::path path = dir / (collection.name + ".gm1");
+            bench::WriteCollection(path, collection.type, NumCollectionEntries);
+
+            runner.Run(prefix + "/Open", [&path]() {
+                    gm1::GM1Reader reader(path);
+                });
+
+            runner.Run(prefix + "/Open(Mapped)", [&path]() {
+                    gm1::GM1Reader reader(path, gm1::GM1Reader::Mapped);
+                });
+
+            const gm1::GM1Reader reader(path, gm1::GM1Reader::Mapped);
+            runner.Run(prefix + "/ReadEntry", [&reader]() {
+                    for(size_t i = 0; i < reader.NumEntries(); ++i) {
+                        reader.ReadEntry(i);
+                    }
+                });
+
+            gm1::GM1Reader cached(path, gm1::GM1Reader::Mapped);
+            cached.SetImageCacheBudget(64 << 20);
+            runner.Run(prefix + "/ReadEntry(ImageCache)", [&cached]() {
+                    for(size_t i = 0; i < cached.NumEntries(); ++i) {
+                        cached.ReadEntry(i);
+                    }
+                });
+        }
+    }
+
+    void RunImage(bench::Runner &runner, const core::Palette &palette)
+    {
+        const core::Image sprite = bench::CreateSprite(ImageSize, ImageSize, palette, 1);
+
+        core::Image blurred = core::ConvertImage(sprite, SDL_PIXELFORMAT_ARGB8888);
+        runner.Run("image/BlurImage(r4x3)", [&blurred]() {
+                core::BlurImage(blurred, 4, 3);
+            });
+
+        core::Image transformed = core::ConvertImage(sprite, SDL_PIXELFORMAT_ARGB8888);
+        runner.Run("image/TransformImage", [&transformed]() {
+                core::TransformImage<core::ARGB8888Format>(transformed, [](const core::Color &color) {
+                        return core::Color(color.g, color.b, color.r, color.a);
+                    });
+            });
+
+        core::Palette indexedPalette = palette;
+        core::Image indexed = core::CreateImage(ImageSize, ImageSize, SDL_PIXELFORMAT_INDEX8);
+        indexed.AttachPalette(indexedPalette);
+        runner.Run("image/ConvertImage(INDEX8->RGB555)", [&indexed]() {
+                core::ConvertImage(indexed, SDL_PIXELFORMAT_RGB555);
+            });
+
+        const core::Image rgb555 = core::ConvertImage(sprite, SDL_PIXELFORMAT_RGB555);
+        runner.Run("image/ConvertImage(RGB555->ARGB8888)", [&rgb555]() {
+                core::ConvertImage(rgb555, SDL_PIXELFORMAT_ARGB8888);
+            });
+
+        runner.Run("image/ConvertImage(ARGB8888->RGB555)", [&sprite]() {
+                core::ConvertImage(sprite, SDL_PIXELFORMAT_RGB555);
+            });
+
+        core::Image keyed = rgb555;
+        keyed.SetColorKey(core::Color(255, 0, 255));
+        core::Image canvas = core::CreateImage(2 * ImageSize, 2 * ImageSize, SDL_PIXELFORMAT_RGB555);
+        const core::Rect rect(ImageSize, ImageSize);
+        runner.Run("image/CopyImage", [&keyed, &canvas, &rect]() {
+                core::CopyImage(keyed, rect, canvas, core::Point(ImageSize / 2, ImageSize / 2));
+            });
+
+        const core::RleSprite rle = core::CreateRleSprite(keyed);
+        runner.Run("image/BlitSprite", [&rle, &canvas]() {
+                core::BlitSprite(rle, canvas, core::Point(ImageSize / 2, ImageSize / 2));
+            });
+    }
+}
+
+int main(int argc, const char *argv[])
+{
+    try {
+        std::string filter;
+        double minTime = 0.5;
+
+        po::options_description opts("Options");
+        opts.add_options()
+            ("help,h",                                                   "Show help")
+            ("filter",   po::value(&filter),                             "Run only benchmarks containing the string")
+            ("min-time", po::value(&minTime)->default_value(minTime),   "Set minimum time per benchmark in seconds")
+            ;
+
+        po::variables_map vars;
+        po::store(po::parse_command_line(argc, argv, opts), vars);
+        if(vars.count("help")) {
+            std::cout << "Usage: bench [options]" << std::endl
+                      << opts << std::endl;
+            return EXIT_SUCCESS;
+        }
+        po::notify(vars);
+
+        const TempDir temp;
+        const core::Palette palette = bench::CreatePalette(0);
+
+        bench::Runner runner(std::cout, filter, minTime);
+        RunTGX(runner, palette);
+        RunGM1(runner, temp.Path());
+        RunImage(runner, palette);
+
+        if(runner.NumRun() == 0) {
+            std::cerr << "No benchmarks match the filter" << std::endl;
+            return EXIT_FAILURE;
+        }
+        return EXIT_SUCCESS;
+    } catch(const std::exception &error) {
+        std::cerr << error.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+}
@@ -0,0 +1,144 @@
+#include "synthetic.h"
+
+#include <cerrno>
+#include <cstring>
+
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem/fstream.hpp>
+
+#include <core/color.h>
+#include <core/image.h>
+#include <core/imagelocker.h>
+#include <core/palette.h>
+
+#include <gm1/gm1.h>
+#include <gm1/gm1entrywriter.h>
+#include <gm1/gm1writer.h>
+
+namespace
+{
+    uint32_t DataClass(gm1::ArchiveType type)
+    {
+        switch(type) {
+        case gm1::ArchiveType::TGX16: return 1;
+        case gm1::ArchiveType::TGX8: return 2;
+        case gm1::ArchiveType::TileObject: return 3;
+        case gm1::ArchiveType::Font: return 4;
+        case gm1::ArchiveType::Bitmap: return 5;
+        default:
+            throw std::logic_error("Unknown archive type");
+        }
+    }
+
+    const size_t SpriteWidth = 64;
+    const size_t SpriteHeight = 96;
+
+    const size_t TileHeight = 40;
+    const size_t TileY = TileHeight - gm1::TileSpriteHeight;
+    const size_t TileBoxOffset = 4;
+    const size_t TileBoxWidth = 22;
+}
+
+namespace bench
+{
+    const core::Palette CreatePalette(size_t seed)
+    {
+        std::minstd_rand rng(seed + 1);
+        std::uniform_int_distribution<int> channel(0, 255);
+
+        core::Palette palette(gm1::CollectionPaletteColors);
+        for(core::Palette::value_type &color : palette) {
+            // Keep them distinct in RGB555, so TGX8 entries map back exactly
+            color = core::Color(channel(rng) & 0xf8, channel(rng) & 0xf8, channel(rng) & 0xf8);
+        }
+        // Index 0 is reserved for transparency.
+        palette[0] = core::Color(255, 0, 255);
+        return palette;
+    }
+
+    const core::Image CreateSprite(size_t width, size_t height, const core::Palette &palette, size_t seed)
+    {
+        std::minstd_rand rng(seed + 1);
+        std::uniform_int_distribution<int> index(1, palette.Size() - 1);
+        std::uniform_int_distribution<int> percent(0, 99);
+
+        core::Image image = core::CreateImage(width, height, SDL_PIXELFORMAT_ARGB8888);
+        core::ClearImage(image, core::Color(255, 0, 255));
+
+        core::ImageLocker lock(image);
+        const SDL_PixelFormat &format = core::ImageFormat(image);
+
+        const double cx = width / 2.0;
+        const double cy = height / 2.0;
+        for(size_t y = 0; y < height; ++y) {
+            uint32_t *pixels = reinterpret_cast<uint32_t*>(lock.Data() + image.RowStride() * y);
+            uint32_t flat = core::Color(palette[index(rng)]).ConvertTo(format);
+            for(size_t x = 0; x < width; ++x) {
+                const double dx = (x - cx) / cx;
+                const double dy = (y - cy) / cy;
+                if(dx * dx + dy * dy > 1.0) {
+                    continue;
+                }
+
+                const int dice = percent(rng);
+                if(dice < 5) {
+                    flat = core::Color(palette[index(rng)]).ConvertTo(format);
+                }
+                pixels[x] = (dice < 70)
+                    ? flat
+                    : core::Color(palette[index(rng)]).ConvertTo(format);
+            }
+        }
+
+        return image;
+    }
+
+    void WriteCollection(const boost::filesystem::path &path, gm1::ArchiveType type, size_t numEntries)
+    {
+        gm1::Header header = gm1::Header();
+        header.dataClass = DataClass(type);
+
+        std::vector<core::Palette> palettes;
+        for(size_t i = 0; i < gm1::CollectionPaletteCount; ++i) {
+            palettes.push_back(CreatePalette(i));
+        }
+
+        gm1::GM1EntryWriter::Ptr writer = gm1::CreateEntryWriter(type);
+        writer->Palette(palettes.front());
+
+        std::vector<gm1::EntryHeader> headers(numEntries);
+        std::vector<std::string> entries(numEntries);
+        for(size_t i = 0; i < numEntries; ++i) {
+            gm1::EntryHeader &entryHeader = headers[i];
+            entryHeader = gm1::EntryHeader();
+
+            core::Image sprite;
+            if(type == gm1::ArchiveType::TileObject) {
+                entryHeader.tileY = TileY;
+                entryHeader.hOffset = TileBoxOffset;
+                entryHeader.boxWidth = TileBoxWidth;
+                sprite = CreateSprite(gm1::TileSpriteWidth, TileHeight, palettes.front(), i);
+            } else {
+                sprite = CreateSprite(SpriteWidth, SpriteHeight, palettes.front(), i);
+            }
+
+            std::ostringstream oss;
+            writer->Save(oss, sprite, entryHeader);
+            entries[i] = oss.str();
+        }
+
+        boost::filesystem::ofstream fout(path, std::ios_base::binary | std::ios_base::out);
+        if(!fout) {
+            throw std::runtime_error(strerror(errno));
+        }
+        gm1::WriteCollection(fout, header, palettes, headers, entries);
+        if(!fout) {
+            throw std::runtime_error(strerror(errno));
+        }
+    }
+}
@@ -0,0 +1,42 @@
+#ifndef SYNTHETIC_H_
+#define SYNTHETIC_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include <boost/filesystem/path.hpp>
+
+namespace core
+{
+    class Image;
+    class Palette;
+}
+
+namespace gm1
+{
+    enum class ArchiveType;
+}
+
+namespace bench
+{
+    /**
+       \brief Palette of a synthetic collection.
+    **/
+    const core::Palette CreatePalette(size_t seed);
+
+    /**
+       \brief Sprite-like ARGB8888 image.
+
+       It is an opaque blob on a transparent background made of a few
+       flat regions and some noise, so tgx has both runs and streams to encode.
+       Colors are taken from the palette.
+    **/
+    const core::Image CreateSprite(size_t width, size_t height, const core::Palette &palette, size_t seed);
+
+    /**
+       \brief Writes GM1 collection of the given type filled with sprites.
+    **/
+    void WriteCollection(const boost::filesystem::path &path, gm1::ArchiveType type, size_t numEntries);
+}
+
+#endif // SYNTHETIC_H_
@@ -4,18 +4,13 @@
 #include <iostream>
 
 #include <core/endianness.h>
-#include <core/sdl_utils.h>
-#include <core/sdl_error.h>
+#include <core/pixelformat.h>
 
 namespace core
 {
     const Color PixelToColor(uint32_t pixel, uint32_t format)
     {
-        const PixelFormatPtr fmt(SDL_AllocFormat(format));
-        if(!fmt) {
-            throw sdl_error();
-        }
-        return PixelToColor(pixel, *fmt);
+        return PixelToColor(pixel, core::GetPixelFormat(format));
     }
 
     const Color PixelToColor(uint32_t pixel, const SDL_PixelFormat &format)
@@ -27,11 +22,7 @@ namespace core
     
     uint32_t Color::ConvertTo(uint32_t format) const
     {
-        const PixelFormatPtr fmt(SDL_AllocFormat(format));
-        if(!fmt) {
-            throw sdl_error();
-        }
-        return ConvertTo(*fmt);
+        return ConvertTo(core::GetPixelFormat(format));
     }
 
     uint32_t Color::ConvertTo(const SDL_PixelFormat &format) const
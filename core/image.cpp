@@ -15,6 +15,8 @@
 #include <core/imagedebug.h>
 #include <core/imagelocker.h>
 #include <core/palette.h>
+#include <core/pixelformat.h>
+#include <core/pixelconvert.h>
 
 #include <core/sdl_utils.h>
 #include <core/sdl_error.h>
@@ -39,6 +41,85 @@ namespace
     }
 }
 
+namespace
+{
+    // Conversions below are done by core/pixelconvert kernels instead
+    // of SDL_ConvertSurface. Source color key makes SDL do some extra work, so
+    // such surfaces are left to SDL.
+    bool CanConvertFast(const core::Image &source, const SDL_PixelFormat &format)
+    {
+        SDL_Surface *surface = source.GetSurface();
+        if(surface == nullptr) {
+            return false;
+        }
+
+        uint32_t colorKey;
+        if(SDL_GetColorKey(surface, &colorKey) == 0) {
+            return false;
+        }
+
+        const uint32_t from = surface->format->format;
+        const uint32_t to = format.format;
+        
+        if(from == SDL_PIXELFORMAT_INDEX8 && surface->format->palette != nullptr) {
+            return (format.BytesPerPixel == 2 || format.BytesPerPixel == 4) && !SDL_ISPIXELFORMAT_INDEXED(to);
+        }
+        
+        return (from == SDL_PIXELFORMAT_RGB555 && to == SDL_PIXELFORMAT_ARGB8888)
+            || (from == SDL_PIXELFORMAT_ARGB8888 && to == SDL_PIXELFORMAT_RGB555);
+    }
+
+    template<class Pixel>
+    void ExpandIndexedRows(const core::Image &source, core::Image &target)
+    {
+        const SDL_Palette &palette = *source.GetSurface()->format->palette;
+        const SDL_PixelFormat &format = core::ImageFormat(target);
+        
+        Pixel table[256] = {};
+        for(int i = 0; i < palette.ncolors && i < 256; ++i) {
+            table[i] = core::Color(palette.colors[i]).ConvertTo(format);
+        }
+
+        const core::ImageLocker sourceLock(source);
+        core::ImageLocker targetLock(target);
+        for(size_t y = 0; y < source.Height(); ++y) {
+            const uint8_t *src = reinterpret_cast<const uint8_t*>(sourceLock.Data() + source.RowStride() * y);
+            Pixel *dst = reinterpret_cast<Pixel*>(targetLock.Data() + target.RowStride() * y);
+            core::ExpandIndex8(src, table, dst, source.Width());
+        }
+    }
+
+    template<class From, class To, void (*Convert)(const From*, To*, size_t)>
+    void ConvertRows(const core::Image &source, core::Image &target)
+    {
+        const core::ImageLocker sourceLock(source);
+        core::ImageLocker targetLock(target);
+        for(size_t y = 0; y < source.Height(); ++y) {
+            const From *src = reinterpret_cast<const From*>(sourceLock.Data() + source.RowStride() * y);
+            To *dst = reinterpret_cast<To*>(targetLock.Data() + target.RowStride() * y);
+            Convert(src, dst, source.Width());
+        }
+    }
+    
+    void ConvertFast(const core::Image &source, core::Image &target)
+    {
+        const uint32_t from = core::ImageFormat(source).format;
+        const SDL_PixelFormat &format = core::ImageFormat(target);
+
+        if(from == SDL_PIXELFORMAT_INDEX8) {
+            if(format.BytesPerPixel == 2) {
+                ExpandIndexedRows<uint16_t>(source, target);
+            } else {
+                ExpandIndexedRows<uint32_t>(source, target);
+            }
+        } else if(from == SDL_PIXELFORMAT_RGB555) {
+            ConvertRows<uint16_t, uint32_t, core::ConvertRGB555ToARGB8888>(source, target);
+        } else {
+            ConvertRows<uint32_t, uint16_t, core::ConvertARGB8888ToRGB555>(source, target);
+        }
+    }
+}
+
 namespace core
 {
     Image::Image() : Image(nullptr) {}
@@ -62,6 +143,28 @@ namespace core
         AddSurfaceRef(mSurface);
     }
 
+    /** Moving never touches refcount, so images may be handed over to other threads **/
+    Image::Image(Image &&that)
+        : mSurface(that.mSurface)
+        , mColorKey(that.mColorKey)
+        , mColorKeyEnabled(that.mColorKeyEnabled)
+    {
+        that.mSurface = nullptr;
+    }
+
+    Image& Image::operator=(Image &&that)
+    {
+        if(this != &that) {
+            SDL_Surface *old = mSurface;
+            mSurface = that.mSurface;
+            mColorKeyEnabled = that.mColorKeyEnabled;
+            mColorKey = that.mColorKey;
+            that.mSurface = nullptr;
+            SDL_FreeSurface(old);
+        }
+        return *this;
+    }
+
     Image& Image::operator=(const Image &that)
     {
         AddSurfaceRef(that.mSurface);
@@ -207,11 +310,7 @@ namespace core
 
     const Image CreateImage(int width, int height, uint32_t format)
     {
-        PixelFormatPtr pf(SDL_AllocFormat(format));
-        if(!pf) {
-            throw sdl_error();
-        }
-        return CreateImage(width, height, *pf);
+        return CreateImage(width, height, core::GetPixelFormat(format));
     }
 
     const Image CreateImageFrom(void *pixels, int width, int height, int rowStride, const SDL_PixelFormat &format)
@@ -235,24 +334,22 @@ namespace core
 
     const Image CreateImageFrom(void *pixels, int width, int height, int rowStride, uint32_t format)
     {
-        PixelFormatPtr pf(SDL_AllocFormat(format));
-        if(!pf) {
-            throw sdl_error();
-        }
-        return CreateImageFrom(pixels, width, height, rowStride, *pf);
+        return CreateImageFrom(pixels, width, height, rowStride, core::GetPixelFormat(format));
     }
 
     const Image ConvertImage(const Image &source, uint32_t format)
     {
-        PixelFormatPtr pf(SDL_AllocFormat(format));
-        if(!pf) {
-            throw sdl_error();
-        }
-        return ConvertImage(source, *pf);
+        return ConvertImage(source, core::GetPixelFormat(format));
     }
 
     const Image ConvertImage(const Image &source, const SDL_PixelFormat &format)
     {
+        if(CanConvertFast(source, format)) {
+            Image tmp = CreateImage(source.Width(), source.Height(), format);
+            ConvertFast(source, tmp);
+            return tmp;
+        }
+        
         Image tmp;
         tmp = SDL_ConvertSurface(source.GetSurface(), &format, 0);
     
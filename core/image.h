@@ -33,9 +33,11 @@ namespace core
     public:
         Image();
         Image(Image const&);
+        Image(Image&&);
         explicit Image(SDL_Surface*);
 
         Image& operator=(Image const&);
+        Image& operator=(Image&&);
         Image& operator=(SDL_Surface*);
         virtual ~Image();
         
@@ -2,6 +2,8 @@
 
 #include <cassert>
 
+#include <algorithm>
+#include <array>
 #include <vector>
 #include <stdexcept>
 
@@ -13,106 +15,226 @@
 
 namespace
 {
-    class ConvolveFunctor
+    typedef std::vector<uint8_t> Plane;
+    typedef std::array<Plane, 4> Planes;
+
+    enum Channel
+    {
+        Red,
+        Green,
+        Blue,
+        Alpha
+    };
+
+    /**
+       \brief Sliding window average over [i - radius, i + radius].
+
+       Window is clamped to the line, so border pixels are averaged over less pixels.
+       Division is replaced by multiplication with precomputed 24-bit reciprocals.
+    **/
+    class BoxFilter
     {
-        std::vector<uint32_t> mBuffer;
-        uint32_t *const mRedBuff;
-        uint32_t *const mGreenBuff;
-        uint32_t *const mBlueBuff;
-        const int mRadius;
-        const SDL_PixelFormat &mFormat;
+        std::vector<uint64_t> mScale;
+        std::vector<uint8_t> mLine;
+        const size_t mRadius;
 
     public:
-        inline ConvolveFunctor(int radius, const SDL_PixelFormat &format, int bufferSize);
-        inline void operator()(char *bytes, int length, int stride);
+        inline BoxFilter(size_t radius, size_t maxLength);
+        inline void operator()(uint8_t *line, size_t length);
     };
 
-    inline ConvolveFunctor::ConvolveFunctor(int radius, const SDL_PixelFormat &format, int bufferSize)
-        : mBuffer(bufferSize * 3)
-        , mRedBuff(mBuffer.data())
-        , mGreenBuff(mBuffer.data() + bufferSize)
-        , mBlueBuff(mBuffer.data() + bufferSize * 2)
+    inline BoxFilter::BoxFilter(size_t radius, size_t maxLength)
+        : mScale(std::min(2 * radius + 1, maxLength) + 1)
+        , mLine(maxLength)
         , mRadius(radius)
-        , mFormat(format)
-    {}
-
-    inline void ConvolveFunctor::operator()(char *bytes, int length, int stride)
-    {    
-        uint32_t redAccum = 0;
-        uint32_t greenAccum = 0;
-        uint32_t blueAccum = 0;
-
-        for(int i = 0; i < length; ++i) {
-            const uint32_t pixel = core::GetPackedPixel(bytes + i * stride, mFormat.BytesPerPixel);
-
-            uint8_t r;
-            uint8_t g;
-            uint8_t b;
-            SDL_GetRGB(pixel, &mFormat, &r, &g, &b);
-
-            redAccum += r;
-            greenAccum += g;
-            blueAccum += b;
-
-            mRedBuff[i] = redAccum;
-            mGreenBuff[i] = greenAccum;
-            mBlueBuff[i] = blueAccum;
+    {
+        for(size_t count = 1; count < mScale.size(); ++count) {
+            mScale[count] = ((1 << 24) + count / 2) / count;
         }
+    }
+
+    inline void BoxFilter::operator()(uint8_t *line, size_t length)
+    {
+        const uint8_t *const src = mLine.data();
+        std::copy(line, line + length, mLine.begin());
 
-        for(int i = 0; i < length; ++i) {
-            const size_t minIndex = std::max(0, i - mRadius);
-            const size_t maxIndex = std::min(i + mRadius, length - 1);
+        uint32_t sum = 0;
+        for(size_t i = 0; i < std::min(mRadius, length); ++i) {
+            sum += src[i];
+        }
+
+        for(size_t i = 0; i < length; ++i) {
+            if(i + mRadius < length) {
+                sum += src[i + mRadius];
+            }
 
-            const uint32_t red = mRedBuff[maxIndex] - mRedBuff[minIndex];
-            const uint32_t green = mGreenBuff[maxIndex] - mGreenBuff[minIndex];
-            const uint32_t blue = mBlueBuff[maxIndex] - mBlueBuff[minIndex];
-            const uint32_t count = maxIndex - minIndex;
+            const size_t first = (i > mRadius) ? i - mRadius : 0;
+            const size_t last = std::min(i + mRadius, length - 1);
+            const size_t count = last - first + 1;
+            line[i] = (sum * mScale[count] + (1 << 23)) >> 24;
 
-            const uint32_t pixel = SDL_MapRGB(&mFormat, red / count, green / count, blue / count);
-            core::SetPackedPixel(bytes + i * stride, pixel, mFormat.BytesPerPixel);
+            if(i >= mRadius) {
+                sum -= src[i - mRadius];
+            }
         }
     }
-}
 
-namespace core
-{
-    void BlurImage(Image &dst, size_t radius)
+    void Transpose(const uint8_t *src, size_t width, size_t height, uint8_t *dst)
     {
-        if(!dst) {
-            throw std::invalid_argument("surface is null or invalid");
+        // Blocks are small enough to keep both source and target rows in L1.
+        const size_t block = 32;
+
+        for(size_t by = 0; by < height; by += block) {
+            const size_t maxY = std::min(by + block, height);
+            for(size_t bx = 0; bx < width; bx += block) {
+                const size_t maxX = std::min(bx + block, width);
+                for(size_t y = by; y < maxY; ++y) {
+                    for(size_t x = bx; x < maxX; ++x) {
+                        dst[x * height + y] = src[y * width + x];
+                    }
+                }
+            }
+        }
+    }
+
+    /**
+       Rows are filtered in place, columns are filtered as rows of the transposed plane.
+    **/
+    void BlurPlane(Plane &plane, Plane &scratch, size_t width, size_t height, size_t radius, size_t passes)
+    {
+        BoxFilter filter(radius, std::max(width, height));
+
+        for(size_t y = 0; y < height; ++y) {
+            for(size_t pass = 0; pass < passes; ++pass) {
+                filter(&plane[y * width], width);
+            }
+        }
+
+        Transpose(plane.data(), width, height, scratch.data());
+
+        for(size_t x = 0; x < width; ++x) {
+            for(size_t pass = 0; pass < passes; ++pass) {
+                filter(&scratch[x * height], height);
+            }
+        }
+
+        Transpose(scratch.data(), height, width, plane.data());
+    }
+
+    bool HasByteChannels(const SDL_PixelFormat &format)
+    {
+        return (format.BytesPerPixel == 4)
+            && (format.palette == nullptr)
+            && (format.Rloss == 0)
+            && (format.Gloss == 0)
+            && (format.Bloss == 0)
+            && (format.Amask == 0 || format.Aloss == 0);
+    }
+
+    void SplitChannels(const core::Image &image, Planes &planes)
+    {
+        const core::ImageLocker lock(image);
+        const SDL_PixelFormat &format = core::ImageFormat(image);
+        const size_t width = image.Width();
+        const size_t bytesPP = format.BytesPerPixel;
+
+        for(size_t y = 0; y < image.Height(); ++y) {
+            const char *row = lock.Data() + image.RowStride() * y;
+            uint8_t *r = &planes[Red][y * width];
+            uint8_t *g = &planes[Green][y * width];
+            uint8_t *b = &planes[Blue][y * width];
+            uint8_t *a = &planes[Alpha][y * width];
+
+            if(HasByteChannels(format)) {
+                const uint32_t *pixels = reinterpret_cast<const uint32_t*>(row);
+                for(size_t x = 0; x < width; ++x) {
+                    r[x] = (pixels[x] & format.Rmask) >> format.Rshift;
+                    g[x] = (pixels[x] & format.Gmask) >> format.Gshift;
+                    b[x] = (pixels[x] & format.Bmask) >> format.Bshift;
+                    a[x] = (format.Amask != 0) ? (pixels[x] & format.Amask) >> format.Ashift : 255;
+                }
+            } else {
+                for(size_t x = 0; x < width; ++x) {
+                    const uint32_t pixel = core::GetPackedPixel(row + x * bytesPP, bytesPP);
+                    SDL_GetRGBA(pixel, &format, &r[x], &g[x], &b[x], &a[x]);
+                }
+            }
+        }
+    }
+
+    void MergeChannels(const Planes &planes, core::Image &image)
+    {
+        core::ImageLocker lock(image);
+        const SDL_PixelFormat &format = core::ImageFormat(image);
+        const size_t width = image.Width();
+        const size_t bytesPP = format.BytesPerPixel;
+
+        for(size_t y = 0; y < image.Height(); ++y) {
+            char *row = lock.Data() + image.RowStride() * y;
+            const uint8_t *r = &planes[Red][y * width];
+            const uint8_t *g = &planes[Green][y * width];
+            const uint8_t *b = &planes[Blue][y * width];
+            const uint8_t *a = &planes[Alpha][y * width];
+
+            if(HasByteChannels(format)) {
+                uint32_t *pixels = reinterpret_cast<uint32_t*>(row);
+                for(size_t x = 0; x < width; ++x) {
+                    pixels[x] = (uint32_t(r[x]) << format.Rshift)
+                        | (uint32_t(g[x]) << format.Gshift)
+                        | (uint32_t(b[x]) << format.Bshift)
+                        | ((uint32_t(a[x]) << format.Ashift) & format.Amask);
+                }
+            } else {
+                for(size_t x = 0; x < width; ++x) {
+                    const uint32_t pixel = SDL_MapRGBA(&format, r[x], g[x], b[x], a[x]);
+                    core::SetPackedPixel(row + x * bytesPP, pixel, bytesPP);
+                }
+            }
         }
+    }
 
-        const auto buffSize = std::max(dst.Width(),
-                                       dst.Height());
+    void BlurChannels(core::Image &image, size_t radius, size_t passes, const std::vector<Channel> &channels)
+    {
+        if(!image) {
+            throw std::invalid_argument("surface is null or invalid");
+        }
 
-        ConvolveFunctor convolve(radius, ImageFormat(dst), buffSize);
-    
-        if(radius < 1 || radius > buffSize) {
+        if(radius < 1 || radius > std::max(image.Width(), image.Height())) {
             throw std::invalid_argument("inproper convolution radius");
         }
 
-        ImageLocker lock(dst);
-        char *const dataBegin = lock.Data();
-    
-        /** Per row convolution **/
-        for(size_t y = 0; y < dst.Height(); ++y) {
-            char *const data = dataBegin + dst.RowStride() * y;
-            const auto count = dst.Width();
-            const auto stride = dst.PixelStride();
-            convolve(data, count, stride);
+        if(passes < 1) {
+            throw std::invalid_argument("number of passes should be positive");
         }
 
-        /** Per column convolution **/
-        for(size_t x = 0; x < dst.Width(); ++x) {
-            char *const data = dataBegin + dst.PixelStride() * x;
-            const auto count = dst.Height();
-            const auto stride = dst.RowStride();
-            convolve(data, count, stride);
+        const size_t area = image.Width() * image.Height();
+        Planes planes;
+        for(Plane &plane : planes) {
+            plane.resize(area);
         }
+        Plane scratch(area);
+
+        SplitChannels(image, planes);
+        for(Channel channel : channels) {
+            BlurPlane(planes[channel], scratch, image.Width(), image.Height(), radius, passes);
+        }
+        MergeChannels(planes, image);
+    }
+}
+
+namespace core
+{
+    void BlurImage(Image &dst, size_t radius, size_t passes)
+    {
+        BlurChannels(dst, radius, passes, {Red, Green, Blue, Alpha});
     }
 
-    void BlurImageAlpha(Image &surface, size_t radius)
+    void BlurImageAlpha(Image &dst, size_t radius, size_t passes)
     {
+        if(!dst.Null() && ImageFormat(dst).Amask == 0) {
+            throw std::invalid_argument("surface has no alpha channel");
+        }
 
+        BlurChannels(dst, radius, passes, {Alpha});
     }
 }
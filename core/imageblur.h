@@ -10,8 +10,21 @@ namespace core
 
 namespace core
 {
-    void BlurImage(Image &surface, size_t radius);
-    void BlurImageAlpha(Image &surface, size_t radius);
+    /**
+       \brief Box blur of all channels including alpha.
+
+       Each pass averages pixels over the (2 * radius + 1) wide window
+       horizontally and then vertically. Three passes are close enough
+       to the gaussian blur.
+    **/
+    void BlurImage(Image &surface, size_t radius, size_t passes = 1);
+
+    /**
+       \brief Same as BlurImage but only alpha channel is touched.
+
+       Useful for soft shadows. Surface should have alpha channel.
+    **/
+    void BlurImageAlpha(Image &surface, size_t radius, size_t passes = 1);
 }
 
 #endif // IMAGEBLUR_H_
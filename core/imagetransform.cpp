@@ -1,66 +1,29 @@
 #include "imagetransform.h"
 
-#include <functional>
-
-#include <SDL.h>
-
-#include <core/imagelocker.h>
-#include <core/image.h>
-#include <core/color.h>
-
-namespace
+namespace core
 {
-    class TransformFunctor
-    {
-        const SDL_PixelFormat &mFormat;
-        std::function<core::Color(core::Color const&)> mFunc;
-
-    public:
-        inline TransformFunctor(const SDL_PixelFormat &format, core::Color func(core::Color const&));
-        inline void operator()(char *bytes, size_t size);
-    };
-
-    inline TransformFunctor::TransformFunctor(const SDL_PixelFormat &format, core::Color func(core::Color const&))
-        : mFormat(format)
-        , mFunc(func)
-    {}
-
-    inline void TransformFunctor::operator()(char *bytes, size_t size)
+    void TransformImage(const Image &image, core::Color func(core::Color const&))
     {
-        const char *end = bytes + size * mFormat.BytesPerPixel;
-        
-        while(bytes != end) {
-            const uint32_t origPixel = core::GetPackedPixel(bytes, mFormat.BytesPerPixel);
-
-            core::Color color;
-            SDL_GetRGBA(origPixel, &mFormat, &color.r, &color.g, &color.b, &color.a);
-
-            const core::Color result = mFunc(color);
-            const uint32_t pixel = SDL_MapRGBA(&mFormat, result.r, result.g, result.b, result.a);
-            core::SetPackedPixel(bytes, pixel, mFormat.BytesPerPixel);
-
-            bytes += mFormat.BytesPerPixel;
+        if(image.Null()) {
+            throw std::invalid_argument("surface is null or invalid");
         }
-    }
-}
 
-namespace core
-{
-    void TransformImage(Image &image, core::Color func(core::Color const&))
-    {
-        assert(!image.Null());
-    
-        ImageLocker lock(image);
+        switch(ImageFormat(image).format) {
+        case RGB555Format::Format:
+            TransformImage<RGB555Format>(image, func);
+            break;
 
-        const auto width = image.Width();
-        const auto rowStride = image.RowStride();
-        char *const bytes = lock.Data();
+        case ARGB8888Format::Format:
+            TransformImage<ARGB8888Format>(image, func);
+            break;
 
-        TransformFunctor transform(ImageFormat(image), func);
+        case Index8Format::Format:
+            TransformImage<Index8Format>(image, func);
+            break;
 
-        for(size_t y = 0; y < image.Height(); ++y) {
-            char *const data = bytes + rowStride * y;
-            transform(data, width);
+        default:
+            TransformImage<AnyFormat>(image, func);
+            break;
         }
     }
 }
@@ -1,14 +1,169 @@
 #ifndef IMAGETRANSFORM_H_
 #define IMAGETRANSFORM_H_
 
-namespace core
-{
-    class Image;
-    class Color;
-}
+#include <cstdint>
+
+#include <stdexcept>
+
+#include <SDL.h>
+
+#include <core/color.h>
+#include <core/image.h>
+#include <core/imagelocker.h>
 
 namespace core
 {
+    /**
+       \brief Pixel format traits for TransformImage.
+
+       Unpack and Pack give the same results as SDL_GetRGBA and SDL_MapRGBA.
+    **/
+    struct RGB555Format
+    {
+        typedef uint16_t Pixel;
+        static const uint32_t Format = SDL_PIXELFORMAT_RGB555;
+
+        static inline Color Unpack(Pixel pixel) {
+            const uint8_t r = (pixel >> 10) & 0x1f;
+            const uint8_t g = (pixel >> 5) & 0x1f;
+            const uint8_t b = pixel & 0x1f;
+            return Color((r << 3) | (r >> 2), (g << 3) | (g >> 2), (b << 3) | (b >> 2));
+        }
+
+        static inline Pixel Pack(const Color &color) {
+            return ((color.r >> 3) << 10) | ((color.g >> 3) << 5) | (color.b >> 3);
+        }
+    };
+
+    struct ARGB8888Format
+    {
+        typedef uint32_t Pixel;
+        static const uint32_t Format = SDL_PIXELFORMAT_ARGB8888;
+
+        static inline Color Unpack(Pixel pixel) {
+            return Color(pixel >> 16, pixel >> 8, pixel, pixel >> 24);
+        }
+
+        static inline Pixel Pack(const Color &color) {
+            return (uint32_t(color.a) << 24) | (uint32_t(color.r) << 16) | (uint32_t(color.g) << 8) | color.b;
+        }
+    };
+
+    /**
+       Indexed images are transformed through the palette, so the
+       callable is invoked only once per palette entry.
+    **/
+    struct Index8Format
+    {
+        typedef uint8_t Pixel;
+        static const uint32_t Format = SDL_PIXELFORMAT_INDEX8;
+    };
+
+    /**
+       Fallback for the rest of formats, pixels are converted by SDL.
+    **/
+    struct AnyFormat
+    {
+        static const uint32_t Format = SDL_PIXELFORMAT_UNKNOWN;
+    };
+
+    template<class Format>
+    struct ImageTransformer
+    {
+        template<class Func>
+        static void Apply(const Image &image, Func &func) {
+            typedef typename Format::Pixel Pixel;
+
+            ImageLocker lock(image);
+            for(size_t y = 0; y < image.Height(); ++y) {
+                Pixel *const pixels = reinterpret_cast<Pixel*>(lock.Data() + image.RowStride() * y);
+                for(size_t x = 0; x < image.Width(); ++x) {
+                    pixels[x] = Format::Pack(func(Format::Unpack(pixels[x])));
+                }
+            }
+        }
+    };
+
+    template<>
+    struct ImageTransformer<Index8Format>
+    {
+        template<class Func>
+        static void Apply(const Image &image, Func &func) {
+            const SDL_PixelFormat &format = ImageFormat(image);
+            if(format.palette == nullptr) {
+                throw std::invalid_argument("indexed surface has no palette");
+            }
+
+            uint8_t table[256];
+            for(int i = 0; i < 256; ++i) {
+                if(i < format.palette->ncolors) {
+                    const Color color = func(Color(format.palette->colors[i]));
+                    table[i] = SDL_MapRGBA(&format, color.r, color.g, color.b, color.a);
+                } else {
+                    table[i] = i;
+                }
+            }
+
+            ImageLocker lock(image);
+            for(size_t y = 0; y < image.Height(); ++y) {
+                uint8_t *const pixels = reinterpret_cast<uint8_t*>(lock.Data() + image.RowStride() * y);
+                for(size_t x = 0; x < image.Width(); ++x) {
+                    pixels[x] = table[pixels[x]];
+                }
+            }
+        }
+    };
+
+    template<>
+    struct ImageTransformer<AnyFormat>
+    {
+        template<class Func>
+        static void Apply(const Image &image, Func &func) {
+            const SDL_PixelFormat &format = ImageFormat(image);
+            const size_t bytesPP = format.BytesPerPixel;
+
+            ImageLocker lock(image);
+            for(size_t y = 0; y < image.Height(); ++y) {
+                char *const bytes = lock.Data() + image.RowStride() * y;
+                for(size_t x = 0; x < image.Width(); ++x) {
+                    Color color;
+                    SDL_GetRGBA(GetPackedPixel(bytes + x * bytesPP, bytesPP), &format, &color.r, &color.g, &color.b, &color.a);
+                    const Color result = func(color);
+                    SetPackedPixel(bytes + x * bytesPP, SDL_MapRGBA(&format, result.r, result.g, result.b, result.a), bytesPP);
+                }
+            }
+        }
+    };
+
+    /**
+       \brief Replaces each pixel of the image by func(pixel).
+
+       Format is one of format traits above, it should match the image.
+       The callable is inlined into the pixel loop.
+
+       \code
+       core::TransformImage<core::ARGB8888Format>(image, [](const core::Color &color) {
+               return color.Opaque(color.a / 2);
+           });
+       \endcode
+    **/
+    template<class Format, class Func>
+    void TransformImage(const Image &image, Func func)
+    {
+        if(image.Null()) {
+            throw std::invalid_argument("surface is null or invalid");
+        }
+
+        if(Format::Format != SDL_PIXELFORMAT_UNKNOWN && Format::Format != ImageFormat(image).format) {
+            throw std::invalid_argument("surface format doesn't match transform format");
+        }
+
+        ImageTransformer<Format>::Apply(image, func);
+    }
+
+    /**
+       \brief Picks the appropriate specialization at runtime.
+    **/
     void TransformImage(const Image &surface, core::Color(core::Color const&));
 }
 
@@ -0,0 +1,80 @@
+#ifndef PARALLEL_H_
+#define PARALLEL_H_
+
+#include <cstddef>
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace core
+{
+    inline size_t HardwareConcurrency()
+    {
+        return std::max<size_t>(1, std::thread::hardware_concurrency());
+    }
+
+    /**
+       \brief Calls func(index) for each index in [0..count) on numThreads threads.
+
+       Indices are handed out one at a time, so items of uneven cost
+       still balance across threads. The calling thread takes part in the work.
+
+       The first exception thrown by func is rethrown on the calling thread
+       after all threads are joined; indices which were not started yet are skipped.
+    **/
+    template<class Func>
+    void ParallelFor(size_t count, size_t numThreads, Func func)
+    {
+        numThreads = std::min(numThreads, count);
+        if(numThreads <= 1) {
+            for(size_t index = 0; index < count; ++index) {
+                func(index);
+            }
+            return;
+        }
+
+        std::atomic<size_t> next(0);
+        std::atomic<bool> failed(false);
+        std::exception_ptr error;
+        std::mutex errorMutex;
+
+        auto worker = [&]() {
+            while(!failed) {
+                const size_t index = next++;
+                if(index >= count) {
+                    break;
+                }
+                try {
+                    func(index);
+                } catch(...) {
+                    std::lock_guard<std::mutex> lock(errorMutex);
+                    if(!error) {
+                        error = std::current_exception();
+                    }
+                    failed = true;
+                }
+            }
+        };
+
+        std::vector<std::thread> threads;
+        threads.reserve(numThreads - 1);
+        for(size_t i = 1; i < numThreads; ++i) {
+            threads.emplace_back(worker);
+        }
+        worker();
+
+        for(std::thread &thread : threads) {
+            thread.join();
+        }
+
+        if(error) {
+            std::rethrow_exception(error);
+        }
+    }
+}
+
+#endif // PARALLEL_H_
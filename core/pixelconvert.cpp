@@ -0,0 +1,213 @@
+#include "pixelconvert.h"
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__)))
+#define CORE_PIXELCONVERT_X86 1
+#include <immintrin.h>
+#else
+#define CORE_PIXELCONVERT_X86 0
+#endif
+
+namespace
+{
+    inline uint32_t Expand5(uint32_t value)
+    {
+        return (value << 3) | (value >> 2);
+    }
+
+    inline uint32_t ExpandRGB555(uint16_t pixel)
+    {
+        return 0xff000000
+            | (Expand5((pixel >> 10) & 0x1f) << 16)
+            | (Expand5((pixel >> 5) & 0x1f) << 8)
+            | Expand5(pixel & 0x1f);
+    }
+
+    inline uint16_t PackRGB555(uint32_t pixel)
+    {
+        return ((pixel >> 9) & 0x7c00)
+            | ((pixel >> 6) & 0x03e0)
+            | ((pixel >> 3) & 0x001f);
+    }
+
+    void RGB555ToARGB8888Scalar(const uint16_t *src, uint32_t *dst, size_t count)
+    {
+        for(size_t i = 0; i < count; ++i) {
+            dst[i] = ExpandRGB555(src[i]);
+        }
+    }
+
+    void ARGB8888ToRGB555Scalar(const uint32_t *src, uint16_t *dst, size_t count)
+    {
+        for(size_t i = 0; i < count; ++i) {
+            dst[i] = PackRGB555(src[i]);
+        }
+    }
+
+    void ExpandIndex8Scalar(const uint8_t *src, const uint32_t *table, uint32_t *dst, size_t count)
+    {
+        for(size_t i = 0; i < count; ++i) {
+            dst[i] = table[src[i]];
+        }
+    }
+
+#if CORE_PIXELCONVERT_X86
+    void RGB555ToARGB8888SSE2(const uint16_t *src, uint32_t *dst, size_t count)
+    {
+        const __m128i mask5 = _mm_set1_epi16(0x1f);
+        const __m128i alpha = _mm_set1_epi16(static_cast<short>(0xff00));
+
+        size_t i = 0;
+        for(; i + 8 <= count; i += 8) {
+            const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+            __m128i r = _mm_and_si128(_mm_srli_epi16(pixels, 10), mask5);
+            __m128i g = _mm_and_si128(_mm_srli_epi16(pixels, 5), mask5);
+            __m128i b = _mm_and_si128(pixels, mask5);
+            r = _mm_or_si128(_mm_slli_epi16(r, 3), _mm_srli_epi16(r, 2));
+            g = _mm_or_si128(_mm_slli_epi16(g, 3), _mm_srli_epi16(g, 2));
+            b = _mm_or_si128(_mm_slli_epi16(b, 3), _mm_srli_epi16(b, 2));
+
+            // Low word of the pixel is GB, high word is AR
+            const __m128i gb = _mm_or_si128(_mm_slli_epi16(g, 8), b);
+            const __m128i ar = _mm_or_si128(r, alpha);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_unpacklo_epi16(gb, ar));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i + 4), _mm_unpackhi_epi16(gb, ar));
+        }
+        RGB555ToARGB8888Scalar(src + i, dst + i, count - i);
+    }
+
+    inline __m128i PackRGB555SSE2(__m128i pixels)
+    {
+        const __m128i r = _mm_and_si128(_mm_srli_epi32(pixels, 9), _mm_set1_epi32(0x7c00));
+        const __m128i g = _mm_and_si128(_mm_srli_epi32(pixels, 6), _mm_set1_epi32(0x03e0));
+        const __m128i b = _mm_and_si128(_mm_srli_epi32(pixels, 3), _mm_set1_epi32(0x001f));
+        return _mm_or_si128(_mm_or_si128(r, g), b);
+    }
+
+    void ARGB8888ToRGB555SSE2(const uint32_t *src, uint16_t *dst, size_t count)
+    {
+        size_t i = 0;
+        for(; i + 8 <= count; i += 8) {
+            const __m128i lo = PackRGB555SSE2(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)));
+            const __m128i hi = PackRGB555SSE2(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 4)));
+            // Values never exceed 0x7fff, so signed saturation is harmless
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packs_epi32(lo, hi));
+        }
+        ARGB8888ToRGB555Scalar(src + i, dst + i, count - i);
+    }
+
+    __attribute__((target("avx2")))
+    void RGB555ToARGB8888AVX2(const uint16_t *src, uint32_t *dst, size_t count)
+    {
+        const __m256i mask5 = _mm256_set1_epi16(0x1f);
+        const __m256i alpha = _mm256_set1_epi16(static_cast<short>(0xff00));
+
+        size_t i = 0;
+        for(; i + 16 <= count; i += 16) {
+            const __m256i pixels = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+            __m256i r = _mm256_and_si256(_mm256_srli_epi16(pixels, 10), mask5);
+            __m256i g = _mm256_and_si256(_mm256_srli_epi16(pixels, 5), mask5);
+            __m256i b = _mm256_and_si256(pixels, mask5);
+            r = _mm256_or_si256(_mm256_slli_epi16(r, 3), _mm256_srli_epi16(r, 2));
+            g = _mm256_or_si256(_mm256_slli_epi16(g, 3), _mm256_srli_epi16(g, 2));
+            b = _mm256_or_si256(_mm256_slli_epi16(b, 3), _mm256_srli_epi16(b, 2));
+
+            const __m256i gb = _mm256_or_si256(_mm256_slli_epi16(g, 8), b);
+            const __m256i ar = _mm256_or_si256(r, alpha);
+
+            // Unpacking works within 128-bit lanes, so we put them back in order
+            const __m256i lo = _mm256_unpacklo_epi16(gb, ar);
+            const __m256i hi = _mm256_unpackhi_epi16(gb, ar);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_permute2x128_si256(lo, hi, 0x20));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i + 8), _mm256_permute2x128_si256(lo, hi, 0x31));
+        }
+        RGB555ToARGB8888SSE2(src + i, dst + i, count - i);
+    }
+
+    __attribute__((target("avx2")))
+    inline __m256i PackRGB555AVX2(__m256i pixels)
+    {
+        const __m256i r = _mm256_and_si256(_mm256_srli_epi32(pixels, 9), _mm256_set1_epi32(0x7c00));
+        const __m256i g = _mm256_and_si256(_mm256_srli_epi32(pixels, 6), _mm256_set1_epi32(0x03e0));
+        const __m256i b = _mm256_and_si256(_mm256_srli_epi32(pixels, 3), _mm256_set1_epi32(0x001f));
+        return _mm256_or_si256(_mm256_or_si256(r, g), b);
+    }
+
+    __attribute__((target("avx2")))
+    void ARGB8888ToRGB555AVX2(const uint32_t *src, uint16_t *dst, size_t count)
+    {
+        size_t i = 0;
+        for(; i + 16 <= count; i += 16) {
+            const __m256i lo = PackRGB555AVX2(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i)));
+            const __m256i hi = PackRGB555AVX2(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i + 8)));
+            const __m256i packed = _mm256_packs_epi32(lo, hi);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_permute4x64_epi64(packed, 0xd8));
+        }
+        ARGB8888ToRGB555SSE2(src + i, dst + i, count - i);
+    }
+
+    __attribute__((target("avx2")))
+    void ExpandIndex8AVX2(const uint8_t *src, const uint32_t *table, uint32_t *dst, size_t count)
+    {
+        const int *base = reinterpret_cast<const int*>(table);
+
+        size_t i = 0;
+        for(; i + 8 <= count; i += 8) {
+            const __m128i bytes = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + i));
+            const __m256i indices = _mm256_cvtepu8_epi32(bytes);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_i32gather_epi32(base, indices, 4));
+        }
+        ExpandIndex8Scalar(src + i, table, dst + i, count - i);
+    }
+#endif
+
+    struct Kernels
+    {
+        void (*rgb555ToARGB8888)(const uint16_t*, uint32_t*, size_t);
+        void (*argb8888ToRGB555)(const uint32_t*, uint16_t*, size_t);
+        void (*expandIndex8)(const uint8_t*, const uint32_t*, uint32_t*, size_t);
+    };
+
+    Kernels SelectKernels()
+    {
+#if CORE_PIXELCONVERT_X86
+        if(__builtin_cpu_supports("avx2")) {
+            return Kernels {RGB555ToARGB8888AVX2, ARGB8888ToRGB555AVX2, ExpandIndex8AVX2};
+        }
+        return Kernels {RGB555ToARGB8888SSE2, ARGB8888ToRGB555SSE2, ExpandIndex8Scalar};
+#else
+        return Kernels {RGB555ToARGB8888Scalar, ARGB8888ToRGB555Scalar, ExpandIndex8Scalar};
+#endif
+    }
+
+    const Kernels& GetKernels()
+    {
+        static const Kernels kernels = SelectKernels();
+        return kernels;
+    }
+}
+
+namespace core
+{
+    void ConvertRGB555ToARGB8888(const uint16_t *src, uint32_t *dst, size_t count)
+    {
+        GetKernels().rgb555ToARGB8888(src, dst, count);
+    }
+
+    void ConvertARGB8888ToRGB555(const uint32_t *src, uint16_t *dst, size_t count)
+    {
+        GetKernels().argb8888ToRGB555(src, dst, count);
+    }
+
+    void ExpandIndex8(const uint8_t *src, const uint32_t *table, uint32_t *dst, size_t count)
+    {
+        GetKernels().expandIndex8(src, table, dst, count);
+    }
+
+    void ExpandIndex8(const uint8_t *src, const uint16_t *table, uint16_t *dst, size_t count)
+    {
+        // Gathering 16-bit entries buys nothing over plain loads
+        for(size_t i = 0; i < count; ++i) {
+            dst[i] = table[src[i]];
+        }
+    }
+}
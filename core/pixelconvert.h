@@ -0,0 +1,39 @@
+#ifndef PIXELCONVERT_H_
+#define PIXELCONVERT_H_
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+   Bulk pixel conversion kernels.
+
+   They give the very same results as SDL_GetRGBA/SDL_MapRGBA applied
+   pixel by pixel: 5-bit channels are expanded by bit replication and
+   8-bit channels are truncated.
+
+   SSE2 and AVX2 versions are picked at runtime when they are available.
+**/
+
+namespace core
+{
+    /**
+       \brief Expands RGB555 pixels into opaque ARGB8888 ones.
+    **/
+    void ConvertRGB555ToARGB8888(const uint16_t *src, uint32_t *dst, size_t count);
+
+    /**
+       \brief Packs ARGB8888 pixels into RGB555 ones, alpha is dropped.
+    **/
+    void ConvertARGB8888ToRGB555(const uint32_t *src, uint16_t *dst, size_t count);
+
+    /**
+       \brief Replaces each index by the entry of the lookup table.
+
+       Lookup table should have 256 entries. It's usually palette
+       already mapped into the target format.
+    **/
+    void ExpandIndex8(const uint8_t *src, const uint32_t *table, uint32_t *dst, size_t count);
+    void ExpandIndex8(const uint8_t *src, const uint16_t *table, uint16_t *dst, size_t count);
+}
+
+#endif // PIXELCONVERT_H_
@@ -0,0 +1,50 @@
+#include "pixelformat.h"
+
+#include <mutex>
+#include <unordered_map>
+
+#include <core/sdl_utils.h>
+#include <core/sdl_error.h>
+
+namespace
+{
+    class PixelFormatRegistry
+    {
+        std::mutex mMutex;
+        std::unordered_map<uint32_t, PixelFormatPtr> mFormats;
+
+    public:
+        const SDL_PixelFormat& Get(uint32_t format)
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+
+            PixelFormatPtr &ptr = mFormats[format];
+            if(!ptr) {
+                ptr.reset(SDL_AllocFormat(format));
+                if(!ptr) {
+                    mFormats.erase(format);
+                    throw sdl_error();
+                }
+            }
+            return *ptr;
+        }
+    };
+}
+
+namespace core
+{
+    const SDL_PixelFormat& GetPixelFormat(uint32_t format)
+    {
+        // Callers tend to convert into the same format again and again
+        // so the last one is kept per thread to skip the lock.
+        thread_local uint32_t lastFormat = SDL_PIXELFORMAT_UNKNOWN;
+        thread_local const SDL_PixelFormat *last = nullptr;
+
+        if(last == nullptr || lastFormat != format) {
+            static PixelFormatRegistry registry;
+            last = &registry.Get(format);
+            lastFormat = format;
+        }
+        return *last;
+    }
+}
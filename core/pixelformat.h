@@ -0,0 +1,21 @@
+#ifndef PIXELFORMAT_H_
+#define PIXELFORMAT_H_
+
+#include <cstdint>
+
+#include <SDL.h>
+
+namespace core
+{
+    /**
+       \brief Returns process-wide instance of the pixel format.
+
+       Formats are allocated on first request and are kept alive until
+       program exit, so the reference never dangles.
+
+       \note It is safe to call from several threads.
+    **/
+    const SDL_PixelFormat& GetPixelFormat(uint32_t format);
+}
+
+#endif // PIXELFORMAT_H_
@@ -0,0 +1,288 @@
+#include "pngwriter.h"
+
+#include <cstdlib>
+
+#include <algorithm>
+#include <stdexcept>
+
+#include <zlib.h>
+
+#include <SDL.h>
+
+#include <core/color.h>
+#include <core/image.h>
+#include <core/imagelocker.h>
+#include <core/pixelconvert.h>
+
+namespace
+{
+    const uint8_t Signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+
+    enum ColorType
+    {
+        Truecolor = 2,
+        Indexed = 3,
+        TruecolorAlpha = 6
+    };
+
+    enum FilterType
+    {
+        FilterNone,
+        FilterSub,
+        FilterUp,
+        FilterAverage,
+        FilterPaeth,
+        NumFilters
+    };
+
+    void AppendBig32(std::vector<char> &out, uint32_t value)
+    {
+        out.push_back(value >> 24);
+        out.push_back(value >> 16);
+        out.push_back(value >> 8);
+        out.push_back(value);
+    }
+
+    void AppendChunk(std::vector<char> &out, const char *type, const char *data, size_t size)
+    {
+        AppendBig32(out, size);
+        const size_t start = out.size();
+        out.insert(out.end(), type, type + 4);
+        out.insert(out.end(), data, data + size);
+
+        const uLong crc = crc32(0, reinterpret_cast<const Bytef*>(out.data() + start), size + 4);
+        AppendBig32(out, crc);
+    }
+
+    inline uint8_t Paeth(int a, int b, int c)
+    {
+        const int p = a + b - c;
+        const int pa = std::abs(p - a);
+        const int pb = std::abs(p - b);
+        const int pc = std::abs(p - c);
+        if(pa <= pb && pa <= pc) {
+            return a;
+        }
+        return (pb <= pc) ? b : c;
+    }
+
+    /**
+       Applies filter to the row, returns sum of residuals as signed bytes.
+       That's the heuristic libpng uses to pick the filter.
+    **/
+    size_t FilterRow(FilterType filter, const uint8_t *row, const uint8_t *prior, size_t size, size_t bpp, uint8_t *dst)
+    {
+        size_t cost = 0;
+        for(size_t i = 0; i < size; ++i) {
+            const int a = (i >= bpp) ? row[i - bpp] : 0;
+            const int b = prior[i];
+            const int c = (i >= bpp) ? prior[i - bpp] : 0;
+
+            uint8_t value = row[i];
+            switch(filter) {
+            case FilterSub:     value -= a; break;
+            case FilterUp:      value -= b; break;
+            case FilterAverage: value -= (a + b) / 2; break;
+            case FilterPaeth:   value -= Paeth(a, b, c); break;
+            default:            break;
+            }
+
+            dst[i] = value;
+            cost += (value < 128) ? value : 256 - value;
+        }
+        return cost;
+    }
+
+    bool IsKeyed(uint32_t pixel, uint32_t key, const SDL_PixelFormat &format)
+    {
+        const uint32_t mask = format.Rmask | format.Gmask | format.Bmask;
+        return (pixel & mask) == (key & mask);
+    }
+
+    /**
+       Unpacks a row of truecolor image into RGB or RGBA bytes.
+    **/
+    void UnpackRow(const char *src, size_t width, const SDL_PixelFormat &format,
+                   bool keyed, uint32_t key, bool alpha, std::vector<uint32_t> &scratch, uint8_t *dst)
+    {
+        const size_t bytesPP = format.BytesPerPixel;
+        uint32_t *argb = scratch.data();
+
+        if(format.format == SDL_PIXELFORMAT_RGB555) {
+            core::ConvertRGB555ToARGB8888(reinterpret_cast<const uint16_t*>(src), argb, width);
+        } else if(format.format == SDL_PIXELFORMAT_ARGB8888) {
+            std::copy(src, src + width * 4, reinterpret_cast<char*>(argb));
+        } else {
+            for(size_t x = 0; x < width; ++x) {
+                core::Color color;
+                SDL_GetRGBA(core::GetPackedPixel(src + x * bytesPP, bytesPP), &format, &color.r, &color.g, &color.b, &color.a);
+                argb[x] = (uint32_t(color.a) << 24) | (uint32_t(color.r) << 16) | (uint32_t(color.g) << 8) | color.b;
+            }
+        }
+
+        for(size_t x = 0; x < width; ++x) {
+            const uint32_t pixel = argb[x];
+            *dst++ = pixel >> 16;
+            *dst++ = pixel >> 8;
+            *dst++ = pixel;
+            if(alpha) {
+                const bool transparent = keyed && IsKeyed(core::GetPackedPixel(src + x * bytesPP, bytesPP), key, format);
+                *dst++ = transparent ? 0 : (pixel >> 24);
+            }
+        }
+    }
+}
+
+namespace core
+{
+    PNGWriter::PNGWriter(int level)
+        : mStream(new z_stream_s())
+        , mLevel(level)
+        , mRaw()
+        , mPrior()
+        , mFiltered()
+        , mBest()
+        , mScratch()
+    {
+        if(deflateInit(mStream.get(), mLevel) != Z_OK) {
+            throw std::invalid_argument("improper compression level");
+        }
+    }
+
+    PNGWriter::~PNGWriter()
+    {
+        deflateEnd(mStream.get());
+    }
+
+    void PNGWriter::SetCompressionLevel(int level)
+    {
+        if(level < Z_DEFAULT_COMPRESSION || level > Z_BEST_COMPRESSION) {
+            throw std::invalid_argument("improper compression level");
+        }
+        // Applied on the next Write, the stream is finished here
+        mLevel = level;
+    }
+
+    int PNGWriter::CompressionLevel() const
+    {
+        return mLevel;
+    }
+
+    void PNGWriter::Deflate(const uint8_t *data, size_t size, std::vector<char> &idat, bool finish)
+    {
+        z_stream_s &stream = *mStream;
+        stream.next_in = const_cast<Bytef*>(data);
+        stream.avail_in = size;
+
+        for(;;) {
+            const size_t used = idat.size();
+            idat.resize(used + std::max<size_t>(deflateBound(&stream, stream.avail_in), 4096));
+            stream.next_out = reinterpret_cast<Bytef*>(idat.data() + used);
+            stream.avail_out = idat.size() - used;
+
+            const int result = deflate(&stream, finish ? Z_FINISH : Z_NO_FLUSH);
+            idat.resize(idat.size() - stream.avail_out);
+            if(result == Z_STREAM_END) {
+                return;
+            }
+            if(result != Z_OK && result != Z_BUF_ERROR) {
+                throw std::runtime_error("deflate failed");
+            }
+            if(!finish && stream.avail_in == 0) {
+                return;
+            }
+        }
+    }
+
+    void PNGWriter::Write(const Image &image, std::vector<char> &out)
+    {
+        if(image.Null()) {
+            throw std::invalid_argument("surface is null or invalid");
+        }
+
+        const SDL_PixelFormat &format = ImageFormat(image);
+        const size_t width = image.Width();
+        const size_t height = image.Height();
+        const bool indexed = (format.palette != nullptr) && (format.BitsPerPixel == 8);
+        const bool keyed = image.ColorKeyEnabled();
+        const uint32_t key = keyed ? image.GetColorKey().ConvertTo(format) : 0;
+        const bool alpha = !indexed && (keyed || format.Amask != 0);
+
+        const size_t bpp = indexed ? 1 : (alpha ? 4 : 3);
+        const size_t rowBytes = width * bpp;
+        const uint8_t colorType = indexed ? Indexed : (alpha ? TruecolorAlpha : Truecolor);
+
+        out.assign(Signature, Signature + sizeof(Signature));
+
+        std::vector<char> header;
+        AppendBig32(header, width);
+        AppendBig32(header, height);
+        header.push_back(8);
+        header.push_back(colorType);
+        header.push_back(0);
+        header.push_back(0);
+        header.push_back(0);
+        AppendChunk(out, "IHDR", header.data(), header.size());
+
+        if(indexed) {
+            const SDL_Palette &palette = *format.palette;
+            std::vector<char> colors;
+            std::vector<char> transparency;
+            for(int i = 0; i < palette.ncolors; ++i) {
+                colors.push_back(palette.colors[i].r);
+                colors.push_back(palette.colors[i].g);
+                colors.push_back(palette.colors[i].b);
+                transparency.push_back((keyed && uint32_t(i) == key) ? 0 : palette.colors[i].a);
+            }
+            AppendChunk(out, "PLTE", colors.data(), colors.size());
+
+            // Trailing opaque entries may be omitted
+            while(!transparency.empty() && static_cast<uint8_t>(transparency.back()) == 255) {
+                transparency.pop_back();
+            }
+            if(!transparency.empty()) {
+                AppendChunk(out, "tRNS", transparency.data(), transparency.size());
+            }
+        }
+
+        mRaw.resize(rowBytes);
+        mPrior.assign(rowBytes, 0);
+        mFiltered.resize(rowBytes + 1);
+        mBest.resize(rowBytes + 1);
+        mScratch.resize(width);
+
+        if(deflateReset(mStream.get()) != Z_OK || deflateParams(mStream.get(), mLevel, Z_DEFAULT_STRATEGY) != Z_OK) {
+            throw std::runtime_error("deflate failed");
+        }
+
+        std::vector<char> idat;
+        const ImageLocker lock(image);
+        for(size_t y = 0; y < height; ++y) {
+            const char *row = lock.Data() + image.RowStride() * y;
+            if(indexed) {
+                std::copy(row, row + rowBytes, mRaw.begin());
+            } else {
+                UnpackRow(row, width, format, keyed, key, alpha, mScratch, mRaw.data());
+            }
+
+            // Filtering doesn't pay off for palette indices
+            mBest[0] = FilterNone;
+            size_t bestCost = FilterRow(FilterNone, mRaw.data(), mPrior.data(), rowBytes, bpp, &mBest[1]);
+            for(int filter = FilterSub; !indexed && filter < NumFilters; ++filter) {
+                const size_t cost = FilterRow(static_cast<FilterType>(filter), mRaw.data(), mPrior.data(), rowBytes, bpp, &mFiltered[1]);
+                if(cost < bestCost) {
+                    bestCost = cost;
+                    mFiltered[0] = filter;
+                    mBest.swap(mFiltered);
+                }
+            }
+
+            Deflate(mBest.data(), mBest.size(), idat, false);
+            mPrior.swap(mRaw);
+        }
+        Deflate(nullptr, 0, idat, true);
+
+        AppendChunk(out, "IDAT", idat.data(), idat.size());
+        AppendChunk(out, "IEND", nullptr, 0);
+    }
+}
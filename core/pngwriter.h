@@ -0,0 +1,58 @@
+#ifndef PNGWRITER_H_
+#define PNGWRITER_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include <memory>
+#include <vector>
+
+struct z_stream_s;
+
+namespace core
+{
+    class Image;
+}
+
+namespace core
+{
+    /**
+       \brief Encodes images into PNG in memory.
+
+       Deflate state and scratch rows are allocated once and reused
+       by each Write, so a single writer should serve many images.
+       Writer is not thread-safe, keep one per thread.
+
+       Indexed images are written with their palette, the rest are
+       written as 8-bit RGB or RGBA. Color key becomes transparency.
+    **/
+    class PNGWriter
+    {
+        std::unique_ptr<z_stream_s> mStream;
+        int mLevel;
+        std::vector<uint8_t> mRaw;
+        std::vector<uint8_t> mPrior;
+        std::vector<uint8_t> mFiltered;
+        std::vector<uint8_t> mBest;
+        std::vector<uint32_t> mScratch;
+
+        void Deflate(const uint8_t *data, size_t size, std::vector<char> &idat, bool finish);
+
+    public:
+        /**
+           \param level  zlib compression level from 0 (store) to 9, -1 stands for default.
+        **/
+        explicit PNGWriter(int level = -1);
+        ~PNGWriter();
+
+        void SetCompressionLevel(int level);
+        int CompressionLevel() const;
+
+        /**
+           \brief Replaces contents of out by encoded image.
+        **/
+        void Write(const Image &image, std::vector<char> &out);
+    };
+}
+
+#endif // PNGWRITER_H_
@@ -0,0 +1,182 @@
+#include "rlesprite.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include <SDL.h>
+
+#include <core/image.h>
+#include <core/imagelocker.h>
+#include <core/color.h>
+#include <core/point.h>
+#include <core/rect.h>
+
+namespace core
+{
+    RleSprite::RleSprite()
+        : mWidth(0)
+        , mHeight(0)
+        , mFormat(SDL_PIXELFORMAT_UNKNOWN)
+        , mPixelStride(0)
+        , mRows(1, 0)
+    {
+    }
+
+    RleSprite::RleSprite(size_t width, size_t height, uint32_t format)
+        : mWidth(width)
+        , mHeight(height)
+        , mFormat(format)
+        , mPixelStride(SDL_BYTESPERPIXEL(format))
+        , mRows(1, 0)
+    {
+        if(mPixelStride == 0) {
+            throw std::invalid_argument("unsupported sprite pixel format");
+        }
+
+        mRows.reserve(height + 1);
+    }
+
+    void RleSprite::AddSpan(size_t x, size_t length)
+    {
+        if(NumRows() >= mHeight) {
+            throw std::logic_error("sprite has no more rows");
+        }
+
+        if(x + length > mWidth) {
+            throw std::out_of_range("span exceeds sprite width");
+        }
+
+        if(mSpans.size() > mRows.back()) {
+            Span &last = mSpans.back();
+            if(x < last.x + last.length) {
+                throw std::invalid_argument("spans should be disjoint and sorted");
+            }
+
+            if(x == last.x + last.length) {
+                last.length += length;
+                return;
+            }
+        }
+
+        mSpans.push_back(Span {static_cast<uint32_t>(x), static_cast<uint32_t>(length), static_cast<uint32_t>(mPixels.size())});
+    }
+
+    void RleSprite::AppendSpan(size_t x, size_t length, const char *pixels)
+    {
+        AddSpan(x, length);
+        mPixels.insert(mPixels.end(), pixels, pixels + length * mPixelStride);
+    }
+
+    void RleSprite::AppendFill(size_t x, size_t length, const char *pixel)
+    {
+        AddSpan(x, length);
+
+        const size_t offset = mPixels.size();
+        mPixels.resize(offset + length * mPixelStride);
+        for(size_t n = 0; n < length; ++n) {
+            std::copy(pixel, pixel + mPixelStride, &mPixels[offset + n * mPixelStride]);
+        }
+    }
+
+    void RleSprite::Reserve(size_t numPixels)
+    {
+        mPixels.reserve(numPixels * mPixelStride);
+    }
+
+    void RleSprite::FinishRow()
+    {
+        if(NumRows() >= mHeight) {
+            throw std::logic_error("sprite has no more rows");
+        }
+
+        mRows.push_back(mSpans.size());
+    }
+
+    size_t RleSprite::NumPixels() const
+    {
+        return mPixels.size() / std::max<size_t>(mPixelStride, 1);
+    }
+
+    const RleSprite CreateRleSprite(const Image &image)
+    {
+        if(image.Null()) {
+            throw std::invalid_argument("surface is null or invalid");
+        }
+
+        const SDL_PixelFormat &format = ImageFormat(image);
+        const size_t bytesPP = format.BytesPerPixel;
+        const bool keyed = image.ColorKeyEnabled();
+        const uint32_t colorKey = keyed ? image.GetColorKey().ConvertTo(format) : 0;
+
+        RleSprite sprite(image.Width(), image.Height(), format.format);
+
+        const ImageLocker lock(image);
+        for(size_t y = 0; y < image.Height(); ++y) {
+            const char *row = lock.Data() + image.RowStride() * y;
+
+            size_t x = 0;
+            while(x < image.Width()) {
+                while((x < image.Width()) && keyed && (GetPackedPixel(row + x * bytesPP, bytesPP) == colorKey)) {
+                    ++x;
+                }
+
+                const size_t first = x;
+                while((x < image.Width()) && !(keyed && (GetPackedPixel(row + x * bytesPP, bytesPP) == colorKey))) {
+                    ++x;
+                }
+
+                if(x > first) {
+                    sprite.AppendSpan(first, x - first, row + first * bytesPP);
+                }
+            }
+
+            sprite.FinishRow();
+        }
+
+        return sprite;
+    }
+
+    void BlitSprite(const RleSprite &sprite, Image &target, const core::Point &targetPoint)
+    {
+        if(target.Null()) {
+            throw std::invalid_argument("surface is null or invalid");
+        }
+
+        if(sprite.Null()) {
+            return;
+        }
+
+        if(ImageFormat(target).format != sprite.Format()) {
+            throw std::invalid_argument("sprite format doesn't match surface format");
+        }
+
+        const core::Rect clip = target.GetClipRect();
+        const int minX = clip.X();
+        const int maxX = clip.X() + clip.Width();
+        const int minY = std::max<int>(clip.Y(), targetPoint.Y());
+        const int maxY = std::min<int>(clip.Y() + clip.Height(), targetPoint.Y() + sprite.NumRows());
+        const size_t bytesPP = sprite.PixelStride();
+
+        ImageLocker lock(target);
+        for(int y = minY; y < maxY; ++y) {
+            char *const row = lock.Data() + target.RowStride() * y;
+            const size_t spriteRow = y - targetPoint.Y();
+
+            for(RleSprite::const_iterator span = sprite.RowBegin(spriteRow); span != sprite.RowEnd(spriteRow); ++span) {
+                const int left = targetPoint.X() + static_cast<int>(span->x);
+                const int right = left + static_cast<int>(span->length);
+                if(right <= minX) {
+                    continue;
+                }
+                if(left >= maxX) {
+                    break;
+                }
+
+                const int first = std::max(left, minX);
+                const int last = std::min(right, maxX);
+                const char *const pixels = sprite.SpanPixels(*span) + (first - left) * bytesPP;
+                std::copy(pixels, pixels + (last - first) * bytesPP, row + first * bytesPP);
+            }
+        }
+    }
+}
@@ -0,0 +1,140 @@
+#ifndef RLESPRITE_H_
+#define RLESPRITE_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include <vector>
+
+namespace core
+{
+    class Image;
+    class Point;
+}
+
+namespace core
+{
+    /**
+       \brief Sprite which keeps only opaque pixels.
+
+       Each row is a list of opaque spans in left to right order,
+       pixels of all spans are packed together. Transparent pixels take
+       no memory and are skipped by BlitSprite without being looked at.
+
+       Rows are built one after another with AppendSpan, AppendFill and FinishRow.
+       Span which starts right where the previous one ends is merged into it.
+    **/
+    class RleSprite
+    {
+    public:
+        struct Span
+        {
+            uint32_t x;
+            uint32_t length;
+            uint32_t offset;    // in bytes from the beginning of pixel data
+        };
+
+        typedef std::vector<Span>::const_iterator const_iterator;
+
+        RleSprite();
+        RleSprite(size_t width, size_t height, uint32_t format);
+
+        void AppendSpan(size_t x, size_t length, const char *pixels);
+        void AppendFill(size_t x, size_t length, const char *pixel);
+        void FinishRow();
+
+        /**
+           \brief Preallocates memory for the given number of opaque pixels.
+        **/
+        void Reserve(size_t numPixels);
+
+        inline size_t Width() const;
+        inline size_t Height() const;
+        inline uint32_t Format() const;
+        inline size_t PixelStride() const;
+        inline size_t NumRows() const;
+        inline bool Null() const;
+
+        inline const_iterator RowBegin(size_t row) const;
+        inline const_iterator RowEnd(size_t row) const;
+        inline const char* SpanPixels(const Span &span) const;
+
+        /**
+           \brief Number of opaque pixels.
+        **/
+        size_t NumPixels() const;
+
+    private:
+        size_t mWidth;
+        size_t mHeight;
+        uint32_t mFormat;
+        size_t mPixelStride;
+        std::vector<Span> mSpans;
+        std::vector<size_t> mRows;      // index of the first span of each row and one past the last row
+        std::vector<char> mPixels;
+
+        void AddSpan(size_t x, size_t length);
+    };
+
+    inline size_t RleSprite::Width() const
+    {
+        return mWidth;
+    }
+
+    inline size_t RleSprite::Height() const
+    {
+        return mHeight;
+    }
+
+    inline uint32_t RleSprite::Format() const
+    {
+        return mFormat;
+    }
+
+    inline size_t RleSprite::PixelStride() const
+    {
+        return mPixelStride;
+    }
+
+    inline size_t RleSprite::NumRows() const
+    {
+        return mRows.size() - 1;
+    }
+
+    inline bool RleSprite::Null() const
+    {
+        return mPixelStride == 0;
+    }
+
+    inline RleSprite::const_iterator RleSprite::RowBegin(size_t row) const
+    {
+        return mSpans.begin() + mRows[row];
+    }
+
+    inline RleSprite::const_iterator RleSprite::RowEnd(size_t row) const
+    {
+        return mSpans.begin() + mRows[row + 1];
+    }
+
+    inline const char* RleSprite::SpanPixels(const Span &span) const
+    {
+        return mPixels.data() + span.offset;
+    }
+
+    /**
+       \brief Makes sprite of image pixels which differ from the color key.
+
+       If color key is disabled all pixels are considered opaque.
+    **/
+    const RleSprite CreateRleSprite(const Image &image);
+
+    /**
+       \brief Copies opaque spans onto the target.
+
+       Spans are clipped by the target clip rect.
+       Target should have the same pixel format as the sprite.
+    **/
+    void BlitSprite(const RleSprite &sprite, Image &target, const core::Point &targetPoint);
+}
+
+#endif // RLESPRITE_H_
@@ -1,7 +1,17 @@
 #include "rw.h"
 
+#include <cerrno>
+#include <cstring>
+
+#include <algorithm>
 #include <iostream>
 
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
 namespace
 {
     template<class StreamModel>
@@ -11,10 +21,10 @@ namespace
     int64_t TellStream(StreamModel &stream);
     
     template<class StreamModel>
-    void ReadStream(StreamModel &stream, char *data, std::streamsize size);
+    std::streamsize ReadStream(StreamModel &stream, char *data, std::streamsize size);
     
     template<class StreamModel>
-    void WriteStream(StreamModel &stream, const char *data, std::streamsize size);
+    std::streamsize WriteStream(StreamModel &stream, const char *data, std::streamsize size);
     
     template<> void SeekStream(std::basic_istream<char> &in, std::streamoff off, std::ios_base::seekdir way)
     {
@@ -36,26 +46,34 @@ namespace
         return static_cast<int64_t>(out.tellp());
     }
 
-    template<> void ReadStream(std::basic_istream<char> &in, char *data, std::streamsize size)
+    template<> std::streamsize ReadStream(std::basic_istream<char> &in, char *data, std::streamsize size)
     {
         in.read(data, size);
+        if(in.eof()) {
+            // Short read is not an error, the stream remains seekable
+            in.clear();
+        }
+        return in.gcount();
     }
     
-    template<> void ReadStream(std::basic_ostream<char> &out, char*, std::streamsize)
+    template<> std::streamsize ReadStream(std::basic_ostream<char> &out, char*, std::streamsize)
     {
         perror("Read from write-only stream");
         out.setstate(std::ios_base::failbit);
+        return 0;
     }
     
-    template<> void WriteStream(std::basic_istream<char> &in, char const*, std::streamsize)
+    template<> std::streamsize WriteStream(std::basic_istream<char> &in, char const*, std::streamsize)
     {
         perror("Write to read-only stream");
         in.setstate(std::ios_base::failbit);
+        return 0;
     }
     
-    template<> void WriteStream(std::basic_ostream<char> &out, const char *data, std::streamsize size)
+    template<> std::streamsize WriteStream(std::basic_ostream<char> &out, const char *data, std::streamsize size)
     {
         out.write(data, size);
+        return out ? size : 0;
     }
 
     int Close(SDL_RWops *context)
@@ -93,24 +111,14 @@ namespace
     size_t Read(SDL_RWops *context, void *data, size_t size, size_t maxnum)
     {
         StreamModel &stream = *reinterpret_cast<StreamModel*>(context->hidden.unknown.data1);
-        
-        const int64_t before = TellStream<StreamModel>(stream);
-        ReadStream<StreamModel>(stream, reinterpret_cast<char*>(data), size * maxnum);
-        const int64_t after = TellStream<StreamModel>(stream);
-        
-        return (stream ? ((after - before) / size) : 0);
+        return ReadStream<StreamModel>(stream, reinterpret_cast<char*>(data), size * maxnum) / size;
     }
 
     template<class StreamModel>
     size_t Write(SDL_RWops *context, const void *data, size_t size, size_t maxnum)
     {
         StreamModel &stream = *reinterpret_cast<StreamModel*>(context->hidden.unknown.data1);
-        
-        const int64_t before = TellStream<StreamModel>(stream);
-        WriteStream<StreamModel>(stream, reinterpret_cast<char const*>(data), size * maxnum);
-        const int64_t after = TellStream<StreamModel>(stream);
-        
-        return (stream ? ((after - before) / size) : 0);
+        return WriteStream<StreamModel>(stream, reinterpret_cast<char const*>(data), size * maxnum) / size;
     }
     
     template<class StreamModel>
@@ -127,6 +135,246 @@ namespace
         }
         return rw;
     }
+
+    core::RWStats& NullStats()
+    {
+        static thread_local core::RWStats stats;
+        return stats;
+    }
+
+    int64_t NewPosition(int64_t position, int64_t size, int64_t offset, int whence)
+    {
+        switch(whence) {
+        case RW_SEEK_SET: return offset;
+        case RW_SEEK_END: return size + offset;
+        case RW_SEEK_CUR:
+        default:
+            return position + offset;
+        }
+    }
+
+    struct BufferContext
+    {
+        std::vector<char> &buffer;
+        size_t position;
+        core::RWStats &stats;
+    };
+
+    BufferContext& GetBufferContext(SDL_RWops *context)
+    {
+        return *reinterpret_cast<BufferContext*>(context->hidden.unknown.data1);
+    }
+
+    int64_t BufferSize(SDL_RWops *context)
+    {
+        return GetBufferContext(context).buffer.size();
+    }
+
+    int64_t BufferSeek(SDL_RWops *context, int64_t offset, int whence)
+    {
+        BufferContext &ctx = GetBufferContext(context);
+        ++ctx.stats.numSeeks;
+
+        const int64_t position = NewPosition(ctx.position, ctx.buffer.size(), offset, whence);
+        if(position < 0) {
+            return SDL_SetError("Seek before the beginning of buffer");
+        }
+        ctx.position = position;
+        return position;
+    }
+
+    size_t BufferRead(SDL_RWops *context, void *data, size_t size, size_t maxnum)
+    {
+        BufferContext &ctx = GetBufferContext(context);
+        ++ctx.stats.numReads;
+
+        if((size == 0) || (ctx.position >= ctx.buffer.size())) {
+            return 0;
+        }
+
+        const size_t num = std::min(maxnum, (ctx.buffer.size() - ctx.position) / size);
+        const char *first = ctx.buffer.data() + ctx.position;
+        std::copy(first, first + num * size, reinterpret_cast<char*>(data));
+        ctx.position += num * size;
+        ctx.stats.bytesRead += num * size;
+        return num;
+    }
+
+    size_t BufferWrite(SDL_RWops *context, const void *data, size_t size, size_t num)
+    {
+        BufferContext &ctx = GetBufferContext(context);
+        ++ctx.stats.numWrites;
+
+        const size_t bytes = size * num;
+        if(ctx.buffer.size() < ctx.position + bytes) {
+            ctx.buffer.resize(ctx.position + bytes);
+        }
+
+        const char *first = reinterpret_cast<const char*>(data);
+        std::copy(first, first + bytes, ctx.buffer.begin() + ctx.position);
+        ctx.position += bytes;
+        ctx.stats.bytesWritten += bytes;
+        return num;
+    }
+
+    int BufferClose(SDL_RWops *context)
+    {
+        if(context != NULL) {
+            delete &GetBufferContext(context);
+            SDL_FreeRW(context);
+        }
+        return 0;
+    }
+
+    struct DescriptorContext
+    {
+        int fd;
+        std::vector<char> pending;
+        size_t capacity;
+        // Position of the first pending byte
+        int64_t position;
+        core::RWStats &stats;
+
+        bool Flush();
+    };
+
+    bool DescriptorContext::Flush()
+    {
+        size_t done = 0;
+        while(done < pending.size()) {
+            const auto result = write(fd, pending.data() + done, pending.size() - done);
+            if(result < 0) {
+                if(errno == EINTR) {
+                    continue;
+                }
+                SDL_SetError("%s", strerror(errno));
+                pending.erase(pending.begin(), pending.begin() + done);
+                position += done;
+                return false;
+            }
+            done += result;
+        }
+
+        position += pending.size();
+        pending.clear();
+        return true;
+    }
+
+    DescriptorContext& GetDescriptorContext(SDL_RWops *context)
+    {
+        return *reinterpret_cast<DescriptorContext*>(context->hidden.unknown.data1);
+    }
+
+    int64_t DescriptorSize(SDL_RWops *context)
+    {
+        DescriptorContext &ctx = GetDescriptorContext(context);
+        if(!ctx.Flush()) {
+            return -1;
+        }
+
+        const auto current = lseek(ctx.fd, 0, SEEK_CUR);
+        const auto end = lseek(ctx.fd, 0, SEEK_END);
+        if(current < 0 || end < 0 || lseek(ctx.fd, current, SEEK_SET) < 0) {
+            return SDL_SetError("%s", strerror(errno));
+        }
+        return end;
+    }
+
+    int64_t DescriptorSeek(SDL_RWops *context, int64_t offset, int whence)
+    {
+        DescriptorContext &ctx = GetDescriptorContext(context);
+        ++ctx.stats.numSeeks;
+
+        const int64_t current = ctx.position + ctx.pending.size();
+        if(whence == RW_SEEK_CUR && offset == 0) {
+            // SDL_RWtell, no need to bother the descriptor
+            return current;
+        }
+
+        if(!ctx.Flush()) {
+            return -1;
+        }
+
+        const int64_t target = (whence == RW_SEEK_END)
+            ? lseek(ctx.fd, offset, SEEK_END)
+            : lseek(ctx.fd, NewPosition(current, 0, offset, whence), SEEK_SET);
+        if(target < 0) {
+            return SDL_SetError("%s", strerror(errno));
+        }
+        ctx.position = target;
+        return target;
+    }
+
+    size_t DescriptorRead(SDL_RWops *context, void *data, size_t size, size_t maxnum)
+    {
+        DescriptorContext &ctx = GetDescriptorContext(context);
+        ++ctx.stats.numReads;
+
+        if(size == 0 || !ctx.Flush()) {
+            return 0;
+        }
+
+        char *bytes = reinterpret_cast<char*>(data);
+        size_t done = 0;
+        while(done < size * maxnum) {
+            const auto result = read(ctx.fd, bytes + done, size * maxnum - done);
+            if(result < 0) {
+                if(errno == EINTR) {
+                    continue;
+                }
+                SDL_SetError("%s", strerror(errno));
+                break;
+            }
+            if(result == 0) {
+                break;
+            }
+            done += result;
+        }
+
+        ctx.position += done;
+        ctx.stats.bytesRead += done;
+        return done / size;
+    }
+
+    size_t DescriptorWrite(SDL_RWops *context, const void *data, size_t size, size_t num)
+    {
+        DescriptorContext &ctx = GetDescriptorContext(context);
+        ++ctx.stats.numWrites;
+
+        if(size == 0) {
+            return 0;
+        }
+
+        const size_t count = size * num;
+        const char *bytes = reinterpret_cast<const char*>(data);
+        ctx.pending.insert(ctx.pending.end(), bytes, bytes + count);
+        if(ctx.pending.size() >= ctx.capacity && !ctx.Flush()) {
+            // Bytes of this call are at the tail of pending ones. Those which
+            // did not reach the descriptor are dropped, so that neither a retry
+            // nor closing writes them again; earlier calls were accepted already.
+            const size_t unwritten = std::min(ctx.pending.size(), count);
+            ctx.pending.resize(ctx.pending.size() - unwritten);
+            ctx.stats.bytesWritten += count - unwritten;
+            return (count - unwritten) / size;
+        }
+
+        ctx.stats.bytesWritten += count;
+        return num;
+    }
+
+    int DescriptorClose(SDL_RWops *context)
+    {
+        int result = 0;
+        if(context != NULL) {
+            DescriptorContext *ctx = &GetDescriptorContext(context);
+            if(!ctx->Flush()) {
+                result = -1;
+            }
+            delete ctx;
+            SDL_FreeRW(context);
+        }
+        return result;
+    }
 }
 
 namespace core
@@ -140,4 +388,41 @@ namespace core
     {
         return SDL_RWFromStream<std::basic_ostream<char>>(os);
     }
+
+    SDL_RWops* SDL_RWFromBuffer(std::vector<char> &buffer, RWStats *stats)
+    {
+        SDL_RWops *rw = SDL_AllocRW();
+        if(rw != NULL) {
+            rw->size = BufferSize;
+            rw->seek = BufferSeek;
+            rw->read = BufferRead;
+            rw->write = BufferWrite;
+            rw->close = BufferClose;
+            rw->type = SDL_RWOPS_UNKNOWN;
+            rw->hidden.unknown.data1 = new BufferContext {buffer, 0, (stats != nullptr) ? *stats : NullStats()};
+        }
+        return rw;
+    }
+
+    SDL_RWops* SDL_RWFromFileDescriptor(int fd, RWStats *stats, size_t bufferSize)
+    {
+        SDL_RWops *rw = SDL_AllocRW();
+        if(rw != NULL) {
+            DescriptorContext *ctx = new DescriptorContext {fd, std::vector<char>(), std::max<size_t>(1, bufferSize), 0, (stats != nullptr) ? *stats : NullStats()};
+            ctx->pending.reserve(ctx->capacity);
+
+            // Pipes have no position, they start from zero
+            const auto position = lseek(fd, 0, SEEK_CUR);
+            ctx->position = (position < 0) ? 0 : position;
+
+            rw->size = DescriptorSize;
+            rw->seek = DescriptorSeek;
+            rw->read = DescriptorRead;
+            rw->write = DescriptorWrite;
+            rw->close = DescriptorClose;
+            rw->type = SDL_RWOPS_UNKNOWN;
+            rw->hidden.unknown.data1 = ctx;
+        }
+        return rw;
+    }
 }
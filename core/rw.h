@@ -1,7 +1,12 @@
 #ifndef RW_H_
 #define RW_H_
 
+#include <cstddef>
+#include <cstdint>
+
 #include <iosfwd>
+#include <vector>
+
 #include <SDL.h>
 
 namespace core
@@ -15,6 +20,38 @@ namespace core
 
     SDL_RWops* SDL_RWFromOutputStream(std::basic_ostream<char>&);
     SDL_RWops* SDL_RWFromInputStream(std::basic_istream<char>&);
+
+/**
+   \brief Counters of calls made through SDL_RWops.
+**/
+    struct RWStats
+    {
+        uint64_t numReads;
+        uint64_t numWrites;
+        uint64_t numSeeks;
+        uint64_t bytesRead;
+        uint64_t bytesWritten;
+    };
+
+/**
+   \brief SDL_RWops over growable memory buffer.
+
+   Reading starts from the beginning of the buffer and stops at its end,
+   writing past the end grows the buffer. Seeking is free.
+   The buffer and stats, if given, should outlive the SDL_RWops.
+**/
+    SDL_RWops* SDL_RWFromBuffer(std::vector<char> &buffer, RWStats *stats = nullptr);
+
+/**
+   \brief SDL_RWops over raw file descriptor.
+
+   Writes are collected in own buffer and passed to the descriptor in
+   large chunks, it is flushed on seeking, reading and closing.
+   Position is tracked without system calls, so the descriptor may be
+   a pipe as long as nobody seeks it. Descriptor is not closed.
+   Failed write reports and keeps only bytes which reached the descriptor.
+**/
+    SDL_RWops* SDL_RWFromFileDescriptor(int fd, RWStats *stats = nullptr, size_t bufferSize = 64 * 1024);
 }
 
 #endif // RW_H_
@@ -0,0 +1,128 @@
+#include "skylinepacker.h"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+#include <core/rect.h>
+
+namespace core
+{
+    SkylinePacker::SkylinePacker(int width, int height)
+        : mWidth(width)
+        , mHeight(height)
+    {
+        if(width <= 0 || height <= 0) {
+            throw std::invalid_argument("packer dimensions should be positive");
+        }
+
+        Clear();
+    }
+
+    void SkylinePacker::Clear()
+    {
+        mSkyline.assign(1, Segment {0, 0, mWidth});
+    }
+
+    int SkylinePacker::Width() const
+    {
+        return mWidth;
+    }
+
+    int SkylinePacker::Height() const
+    {
+        return mHeight;
+    }
+
+    int SkylinePacker::FitAt(size_t index, int width, int height) const
+    {
+        const int x = mSkyline[index].x;
+        if(x + width > mWidth) {
+            return -1;
+        }
+
+        int y = 0;
+        int widthLeft = width;
+        for(size_t i = index; widthLeft > 0; ++i) {
+            y = std::max(y, mSkyline[i].y);
+            if(y + height > mHeight) {
+                return -1;
+            }
+            widthLeft -= mSkyline[i].width;
+        }
+
+        return y;
+    }
+
+    void SkylinePacker::PlaceAt(size_t index, const core::Rect &rect)
+    {
+        mSkyline.insert(mSkyline.begin() + index, Segment {rect.X(), rect.Y() + rect.Height(), rect.Width()});
+
+        // Cut segments which are covered by the new one
+        for(size_t i = index + 1; i < mSkyline.size(); ) {
+            const Segment &prev = mSkyline[i - 1];
+            Segment &segment = mSkyline[i];
+
+            const int overlap = prev.x + prev.width - segment.x;
+            if(overlap <= 0) {
+                break;
+            }
+
+            segment.x += overlap;
+            segment.width -= overlap;
+            if(segment.width > 0) {
+                break;
+            }
+            mSkyline.erase(mSkyline.begin() + i);
+        }
+
+        MergeSegments();
+    }
+
+    void SkylinePacker::MergeSegments()
+    {
+        for(size_t i = 0; i + 1 < mSkyline.size(); ) {
+            if(mSkyline[i].y == mSkyline[i + 1].y) {
+                mSkyline[i].width += mSkyline[i + 1].width;
+                mSkyline.erase(mSkyline.begin() + i + 1);
+            } else {
+                ++i;
+            }
+        }
+    }
+
+    bool SkylinePacker::Insert(int width, int height, core::Rect &placed)
+    {
+        if(width <= 0 || height <= 0) {
+            throw std::invalid_argument("rect dimensions should be positive");
+        }
+
+        size_t bestIndex = mSkyline.size();
+        int bestBottom = std::numeric_limits<int>::max();
+        int bestWidth = std::numeric_limits<int>::max();
+        int bestY = 0;
+
+        for(size_t i = 0; i < mSkyline.size(); ++i) {
+            const int y = FitAt(i, width, height);
+            if(y < 0) {
+                continue;
+            }
+
+            const int bottom = y + height;
+            if((bottom < bestBottom) || ((bottom == bestBottom) && (mSkyline[i].width < bestWidth))) {
+                bestIndex = i;
+                bestBottom = bottom;
+                bestWidth = mSkyline[i].width;
+                bestY = y;
+            }
+        }
+
+        if(bestIndex == mSkyline.size()) {
+            return false;
+        }
+
+        placed = core::Rect(mSkyline[bestIndex].x, bestY, width, height);
+        PlaceAt(bestIndex, placed);
+        return true;
+    }
+}
@@ -0,0 +1,55 @@
+#ifndef SKYLINEPACKER_H_
+#define SKYLINEPACKER_H_
+
+#include <cstddef>
+#include <vector>
+
+namespace core
+{
+    class Rect;
+}
+
+namespace core
+{
+    /**
+       \brief Packs rectangles into the fixed size bin.
+
+       The top edge of the used area is kept as a list of horizontal segments.
+       Each rectangle is placed onto the segment where its bottom edge
+       ends up lowest (bottom-left rule), ties are broken by the narrower segment.
+    **/
+    class SkylinePacker
+    {
+        struct Segment
+        {
+            int x;
+            int y;
+            int width;
+        };
+
+        int mWidth;
+        int mHeight;
+        std::vector<Segment> mSkyline;
+
+        int FitAt(size_t index, int width, int height) const;
+        void PlaceAt(size_t index, const core::Rect &rect);
+        void MergeSegments();
+
+    public:
+        SkylinePacker(int width, int height);
+
+        /**
+           \brief Finds place for the rectangle.
+
+           \return false if there is no room for it.
+        **/
+        bool Insert(int width, int height, core::Rect &placed);
+
+        void Clear();
+
+        int Width() const;
+        int Height() const;
+    };
+}
+
+#endif // SKYLINEPACKER_H_
@@ -0,0 +1,164 @@
+#include "taskpool.h"
+
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+namespace
+{
+    struct CurrentWorker
+    {
+        const core::TaskPool *pool;
+        size_t index;
+    };
+
+    thread_local CurrentWorker current = {nullptr, 0};
+}
+
+namespace core
+{
+    TaskPool::TaskPool(size_t numThreads)
+        : mPending(0)
+        , mQueued(0)
+        , mSteals(0)
+        , mFailed(false)
+        , mNextWorker(0)
+    {
+        if(numThreads == 0) {
+            throw std::invalid_argument("number of threads should be positive");
+        }
+
+        for(size_t i = 0; i < numThreads; ++i) {
+            mWorkers.emplace_back(new Worker);
+        }
+    }
+
+    TaskPool::~TaskPool() = default;
+
+    size_t TaskPool::NumThreads() const
+    {
+        return mWorkers.size();
+    }
+
+    size_t TaskPool::NumSteals() const
+    {
+        return mSteals;
+    }
+
+    void TaskPool::Spawn(Task task)
+    {
+        size_t worker;
+        if(current.pool == this) {
+            worker = current.index;
+        } else {
+            std::lock_guard<std::mutex> lock(mIdleMutex);
+            worker = mNextWorker;
+            mNextWorker = (mNextWorker + 1) % mWorkers.size();
+        }
+
+        ++mPending;
+        {
+            std::lock_guard<std::mutex> lock(mWorkers[worker]->mutex);
+            mWorkers[worker]->tasks.push_back(std::move(task));
+            ++mQueued;
+        }
+
+        // Idle threads check the counters under the mutex, so the wake up is not lost
+        std::lock_guard<std::mutex> lock(mIdleMutex);
+        mIdle.notify_one();
+    }
+
+    bool TaskPool::PopTask(size_t worker, Task &task)
+    {
+        Worker &own = *mWorkers[worker];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if(own.tasks.empty()) {
+            return false;
+        }
+
+        task = std::move(own.tasks.back());
+        own.tasks.pop_back();
+        --mQueued;
+        return true;
+    }
+
+    bool TaskPool::StealTask(size_t worker, Task &task)
+    {
+        for(size_t i = 1; i < mWorkers.size(); ++i) {
+            Worker &victim = *mWorkers[(worker + i) % mWorkers.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if(!victim.tasks.empty()) {
+                task = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+                --mQueued;
+                ++mSteals;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void TaskPool::Execute(Task &task)
+    {
+        if(!mFailed) {
+            try {
+                task();
+            } catch(...) {
+                std::lock_guard<std::mutex> lock(mErrorMutex);
+                if(!mError) {
+                    mError = std::current_exception();
+                }
+                mFailed = true;
+            }
+        }
+        task = Task();
+
+        if(--mPending == 0) {
+            std::lock_guard<std::mutex> lock(mIdleMutex);
+            mIdle.notify_all();
+        }
+    }
+
+    void TaskPool::Work(size_t worker)
+    {
+        const CurrentWorker saved = current;
+        current = CurrentWorker {this, worker};
+
+        Task task;
+        while(mPending != 0) {
+            if(PopTask(worker, task) || StealTask(worker, task)) {
+                Execute(task);
+                continue;
+            }
+
+            // Some task is still running and may spawn more
+            std::unique_lock<std::mutex> lock(mIdleMutex);
+            mIdle.wait(lock, [this]() {
+                    return (mQueued != 0) || (mPending == 0);
+                });
+        }
+
+        current = saved;
+    }
+
+    void TaskPool::Run()
+    {
+        std::vector<std::thread> threads;
+        threads.reserve(mWorkers.size() - 1);
+        for(size_t i = 1; i < mWorkers.size(); ++i) {
+            threads.emplace_back(&TaskPool::Work, this, i);
+        }
+        Work(0);
+
+        for(std::thread &thread : threads) {
+            thread.join();
+        }
+
+        mFailed = false;
+        std::exception_ptr error;
+        std::swap(error, mError);
+        if(error) {
+            std::rethrow_exception(error);
+        }
+    }
+}
@@ -0,0 +1,91 @@
+#ifndef TASKPOOL_H_
+#define TASKPOOL_H_
+
+#include <cstddef>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace core
+{
+    /**
+       \brief Runs tasks on a fixed number of threads with work stealing.
+
+       Every thread owns a queue. Tasks spawned by a running task go to the
+       back of the queue of its thread and are taken from the back again, so
+       related work stays on one thread. A thread which runs out of tasks
+       steals from the front of the other queues, where the oldest and
+       usually the largest pieces of work are.
+
+       The first exception thrown by a task is rethrown by Run after all
+       threads are joined; tasks which were not started yet are dropped.
+
+       \code
+       core::TaskPool pool(core::HardwareConcurrency());
+       pool.Spawn([&pool]() {
+               for(size_t i = 0; i < 100; ++i) {
+                   pool.Spawn([i]() { ... });
+               }
+           });
+       pool.Run();
+       \endcode
+    **/
+    class TaskPool
+    {
+    public:
+        typedef std::function<void()> Task;
+
+        explicit TaskPool(size_t numThreads);
+        ~TaskPool();
+
+        TaskPool(TaskPool const&) = delete;
+        TaskPool& operator=(TaskPool const&) = delete;
+
+        /**
+           Tasks spawned outside of Run are dealt round robin.
+        **/
+        void Spawn(Task task);
+
+        /**
+           Blocks until all tasks including spawned ones are done.
+           The calling thread takes part in the work.
+        **/
+        void Run();
+
+        size_t NumThreads() const;
+        size_t NumSteals() const;
+
+    private:
+        struct Worker
+        {
+            std::mutex mutex;
+            std::deque<Task> tasks;
+        };
+
+        std::vector<std::unique_ptr<Worker>> mWorkers;
+        std::atomic<size_t> mPending;
+        std::atomic<size_t> mQueued;
+        std::atomic<size_t> mSteals;
+        std::atomic<bool> mFailed;
+        size_t mNextWorker;
+
+        std::mutex mIdleMutex;
+        std::condition_variable mIdle;
+
+        std::mutex mErrorMutex;
+        std::exception_ptr mError;
+
+        bool PopTask(size_t worker, Task &task);
+        bool StealTask(size_t worker, Task &task);
+        void Execute(Task &task);
+        void Work(size_t worker);
+    };
+}
+
+#endif // TASKPOOL_H_
@@ -13,6 +13,9 @@ namespace gm1
     const unsigned TileBytes = 512;
     const unsigned TileSpriteWidth = 30;
     const unsigned TileSpriteHeight = 16;
+
+    // Width of tile rhombus rows in pixels.
+    constexpr uint8_t TilePixelsPerRow[TileSpriteHeight] = {2, 6, 10, 14, 18, 22, 26, 30, 30, 26, 22, 18, 14, 10, 6, 2};
     
     const unsigned CollectionEntryHeaderBytes = 16;
     const unsigned CollectionHeaderBytes = 88;
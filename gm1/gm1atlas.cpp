@@ -0,0 +1,189 @@
+#include "gm1atlas.h"
+
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <core/color.h>
+#include <core/palette.h>
+#include <core/parallel.h>
+#include <core/point.h>
+#include <core/skylinepacker.h>
+
+#include <gm1/gm1.h>
+#include <gm1/gm1reader.h>
+
+namespace
+{
+    const core::Color PageBackground(255, 0, 255, 0);
+
+    const char IndexSignature[] = "# collection index page x y width height posX posY tileY hOffset";
+
+    bool Taller(const core::Image &lhs, const core::Image &rhs)
+    {
+        if(lhs.Height() != rhs.Height()) {
+            return lhs.Height() > rhs.Height();
+        }
+        return lhs.Width() > rhs.Width();
+    }
+
+    core::Image CreatePage(int width, int height, uint32_t format)
+    {
+        core::Image page = core::CreateImage(width, height, format);
+        core::ClearImage(page, PageBackground);
+        page.SetColorKey(PageBackground);
+        return page;
+    }
+}
+
+namespace gm1
+{
+    AtlasBuilder::AtlasBuilder(int pageWidth, int pageHeight, uint32_t format, int padding)
+        : mPageWidth(pageWidth)
+        , mPageHeight(pageHeight)
+        , mPadding(padding)
+        , mFormat(format)
+        , mNumCollections(0)
+    {
+        if(pageWidth <= 0 || pageHeight <= 0) {
+            throw std::invalid_argument("page dimensions should be positive");
+        }
+
+        if(padding < 0) {
+            throw std::invalid_argument("padding should not be negative");
+        }
+    }
+
+    size_t AtlasBuilder::AddCollection(const GM1Reader &reader, size_t paletteIndex)
+    {
+        if(paletteIndex >= reader.NumPalettes()) {
+            throw std::logic_error("Palette index is out of range");
+        }
+
+        const size_t collection = mNumCollections++;
+        const core::Palette &palette = reader.Palette(paletteIndex);
+
+        const std::vector<core::Image> images = reader.ReadEntries(0, reader.NumEntries(), core::HardwareConcurrency());
+        for(size_t index = 0; index < reader.NumEntries(); ++index) {
+            const gm1::EntryHeader &header = reader.EntryHeader(index);
+
+            Item item;
+            item.entry = AtlasEntry {collection, index, 0, core::Rect(), header.posX, header.posY, header.tileY, header.hOffset};
+            item.image = images[index];
+
+            if(core::IsPalettized(item.image)) {
+                core::Palette copied(palette.Size());
+                std::copy(palette.begin(), palette.end(), copied.begin());
+                item.image.AttachPalette(copied);
+            }
+
+            mItems.push_back(item);
+        }
+
+        return collection;
+    }
+
+    const Atlas AtlasBuilder::Build() const
+    {
+        std::vector<const Item*> order;
+        for(const Item &item : mItems) {
+            if(item.image.Width() > 0 && item.image.Height() > 0) {
+                order.push_back(&item);
+            }
+        }
+        std::stable_sort(order.begin(), order.end(), [](const Item *lhs, const Item *rhs) {
+                return Taller(lhs->image, rhs->image);
+            });
+
+        Atlas atlas;
+        std::vector<core::SkylinePacker> packers;
+
+        for(const Item *item : order) {
+            const int width = item->image.Width() + mPadding;
+            const int height = item->image.Height() + mPadding;
+            if(width > mPageWidth || height > mPageHeight) {
+                std::ostringstream oss;
+                oss << "Entry " << item->entry.index << " doesn't fit the page";
+                throw std::logic_error(oss.str());
+            }
+
+            AtlasEntry entry = item->entry;
+            core::Rect placed;
+
+            entry.page = 0;
+            while((entry.page < packers.size()) && !packers[entry.page].Insert(width, height, placed)) {
+                ++entry.page;
+            }
+
+            if(entry.page == packers.size()) {
+                packers.emplace_back(mPageWidth, mPageHeight);
+                packers.back().Insert(width, height, placed);
+                atlas.pages.push_back(CreatePage(mPageWidth, mPageHeight, mFormat));
+            }
+
+            entry.rect = core::Rect(placed.X(), placed.Y(), item->image.Width(), item->image.Height());
+            core::CopyImage(item->image, core::Rect(item->image.Width(), item->image.Height()),
+                            atlas.pages[entry.page], core::Point(entry.rect.X(), entry.rect.Y()));
+            atlas.entries.push_back(entry);
+        }
+
+        // Keep the order entries were added in
+        std::sort(atlas.entries.begin(), atlas.entries.end(), [](const AtlasEntry &lhs, const AtlasEntry &rhs) {
+                return (lhs.collection != rhs.collection)
+                    ? (lhs.collection < rhs.collection)
+                    : (lhs.index < rhs.index);
+            });
+
+        return atlas;
+    }
+
+    std::ostream& WriteAtlasIndex(std::ostream &out, const Atlas &atlas)
+    {
+        out << IndexSignature << std::endl;
+        for(const AtlasEntry &entry : atlas.entries) {
+            out << entry.collection << ' '
+                << entry.index << ' '
+                << entry.page << ' '
+                << entry.rect.X() << ' '
+                << entry.rect.Y() << ' '
+                << entry.rect.Width() << ' '
+                << entry.rect.Height() << ' '
+                << entry.posX << ' '
+                << entry.posY << ' '
+                << entry.tileY << ' '
+                << static_cast<int>(entry.hOffset)
+                << std::endl;
+        }
+        return out;
+    }
+
+    std::istream& ReadAtlasIndex(std::istream &in, std::vector<AtlasEntry> &entries)
+    {
+        std::string line;
+        while(std::getline(in, line)) {
+            if(line.empty() || line[0] == '#') {
+                continue;
+            }
+
+            std::istringstream iss(line);
+            AtlasEntry entry;
+            int x;
+            int y;
+            int width;
+            int height;
+            int hOffset;
+            if(!(iss >> entry.collection >> entry.index >> entry.page
+                 >> x >> y >> width >> height
+                 >> entry.posX >> entry.posY >> entry.tileY >> hOffset)) {
+                throw std::runtime_error("Malformed atlas index line: " + line);
+            }
+            entry.rect = core::Rect(x, y, width, height);
+            entry.hOffset = hOffset;
+            entries.push_back(entry);
+        }
+        return in;
+    }
+}
@@ -0,0 +1,96 @@
+#ifndef GM1ATLAS_H_
+#define GM1ATLAS_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <vector>
+
+#include <SDL.h>
+
+#include <core/image.h>
+#include <core/rect.h>
+
+namespace gm1
+{
+    class GM1Reader;
+}
+
+namespace gm1
+{
+    /**
+     * \brief Placement of a single entry in the atlas.
+     *
+     * Anchor fields are copied from the entry header.
+     */
+    struct AtlasEntry
+    {
+        size_t collection;
+        size_t index;
+        size_t page;
+        core::Rect rect;
+        uint16_t posX;
+        uint16_t posY;
+        int16_t tileY;
+        uint8_t hOffset;
+    };
+
+    /**
+     * \brief Entries of several collections packed into a few pages.
+     *
+     * Transparent pixels of pages are cleared to the transparent color
+     * with zero alpha and it is also set as the color key of pages.
+     */
+    struct Atlas
+    {
+        std::vector<core::Image> pages;
+        std::vector<AtlasEntry> entries;
+    };
+
+    class AtlasBuilder
+    {
+        struct Item
+        {
+            AtlasEntry entry;
+            core::Image image;
+        };
+
+        int mPageWidth;
+        int mPageHeight;
+        int mPadding;
+        uint32_t mFormat;
+        size_t mNumCollections;
+        std::vector<Item> mItems;
+
+    public:
+        AtlasBuilder(int pageWidth, int pageHeight, uint32_t format = SDL_PIXELFORMAT_ARGB8888, int padding = 1);
+
+        /**
+         * \brief Decodes all entries of the collection.
+         *
+         * 8-bit entries are drawn with the given palette.
+         *
+         * \return Index of the collection in atlas entries.
+         */
+        size_t AddCollection(const GM1Reader &reader, size_t paletteIndex = 0);
+
+        /**
+         * \brief Packs entries from the tallest to the lowest.
+         *
+         * \throw std::logic_error if some entry doesn't fit the page.
+         */
+        const Atlas Build() const;
+    };
+
+    /**
+     * \brief Text index of the atlas, one entry per line.
+     *
+     *      <collection> <index> <page> <x> <y> <width> <height> <posX> <posY> <tileY> <hOffset>
+     *
+     * Pages are written separately.
+     */
+    std::ostream& WriteAtlasIndex(std::ostream &out, const Atlas &atlas);
+    std::istream& ReadAtlasIndex(std::istream &in, std::vector<AtlasEntry> &entries);
+}
+
+#endif // GM1ATLAS_H_
@@ -0,0 +1,251 @@
+#include "gm1cache.h"
+
+#include <cerrno>
+#include <cstring>
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+#include <boost/filesystem/fstream.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
+
+#include <core/image.h>
+#include <core/imagelocker.h>
+#include <core/parallel.h>
+
+#include <gm1/gm1reader.h>
+
+namespace
+{
+    const char Magic[8] = {'G', 'M', '1', 'C', 'A', 'C', 'H', 'E'};
+    const uint32_t Version = 1;
+    const size_t DataAlignment = 64;
+
+    uint64_t HashString(const std::string &str)
+    {
+        // FNV-1a, unlike std::hash it is the same everywhere
+        uint64_t hash = 14695981039346656037ull;
+        for(unsigned char c : str) {
+            hash ^= c;
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    size_t AlignUp(size_t value, size_t alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+}
+
+namespace gm1
+{
+    struct DecodeCache::FileHeader
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t numEntries;
+        uint64_t pathHash;
+        uint64_t fileSize;
+        int64_t modified;
+        uint32_t transparent;
+        uint32_t reserved;
+    };
+
+    struct DecodeCache::FileEntry
+    {
+        uint64_t offset;
+        uint32_t width;
+        uint32_t height;
+        uint32_t rowBytes;
+        uint32_t format;
+    };
+
+    DecodeCache::DecodeCache()
+        : mMapping()
+        , mEntries(nullptr)
+        , mNumEntries(0)
+    {
+    }
+
+    DecodeCache::~DecodeCache() = default;
+
+    bool DecodeCache::Open(const boost::filesystem::path &file, const DecodeCacheKey &key)
+    {
+        Close();
+
+        boost::system::error_code error;
+        if(!boost::filesystem::is_regular_file(file, error)) {
+            return false;
+        }
+
+        std::unique_ptr<boost::iostreams::mapped_file_source> mapping;
+        try {
+            mapping.reset(new boost::iostreams::mapped_file_source(file));
+        } catch(const std::exception&) {
+            return false;
+        }
+
+        const size_t fileSize = mapping->size();
+        if(fileSize < sizeof(FileHeader)) {
+            return false;
+        }
+
+        FileHeader header;
+        std::copy(mapping->data(), mapping->data() + sizeof(header), reinterpret_cast<char*>(&header));
+        if(!std::equal(Magic, Magic + sizeof(Magic), header.magic)
+           || (header.version != Version)
+           || (header.pathHash != HashString(key.path))
+           || (header.fileSize != key.fileSize)
+           || (header.modified != key.modified)
+           || (header.transparent != key.transparent)) {
+            return false;
+        }
+
+        const size_t tableEnd = sizeof(FileHeader) + header.numEntries * sizeof(FileEntry);
+        if(fileSize < tableEnd) {
+            return false;
+        }
+
+        const FileEntry *entries = reinterpret_cast<const FileEntry*>(mapping->data() + sizeof(FileHeader));
+        for(size_t i = 0; i < header.numEntries; ++i) {
+            const FileEntry &entry = entries[i];
+            const uint64_t bytes = uint64_t(entry.rowBytes) * entry.height;
+            if((entry.offset < tableEnd) || (entry.offset > fileSize) || (bytes > fileSize - entry.offset)) {
+                return false;
+            }
+        }
+
+        mMapping = std::move(mapping);
+        mEntries = entries;
+        mNumEntries = header.numEntries;
+        return true;
+    }
+
+    void DecodeCache::Close()
+    {
+        mMapping.reset();
+        mEntries = nullptr;
+        mNumEntries = 0;
+    }
+
+    bool DecodeCache::IsOpened() const
+    {
+        return mMapping != nullptr;
+    }
+
+    size_t DecodeCache::NumEntries() const
+    {
+        return mNumEntries;
+    }
+
+    const core::Image DecodeCache::Load(size_t index) const
+    {
+        if(index >= mNumEntries) {
+            throw std::out_of_range("Cached entry index is out of range");
+        }
+
+        const FileEntry &entry = mEntries[index];
+        core::Image image = core::CreateImage(entry.width, entry.height, entry.format);
+
+        core::ImageLocker lock(image);
+        const char *pixels = mMapping->data() + entry.offset;
+        for(size_t y = 0; y < entry.height; ++y) {
+            std::copy(pixels, pixels + entry.rowBytes, lock.Data() + image.RowStride() * y);
+            pixels += entry.rowBytes;
+        }
+
+        return image;
+    }
+
+    void DecodeCache::Write(const boost::filesystem::path &file, const DecodeCacheKey &key, const GM1Reader &reader)
+    {
+        std::vector<core::Image> images(reader.NumEntries());
+        core::ParallelFor(images.size(), core::HardwareConcurrency(), [&images, &reader](size_t index) {
+                images[index] = reader.ReadEntry(index);
+            });
+
+        FileHeader header = FileHeader();
+        std::copy(Magic, Magic + sizeof(Magic), header.magic);
+        header.version = Version;
+        header.numEntries = images.size();
+        header.pathHash = HashString(key.path);
+        header.fileSize = key.fileSize;
+        header.modified = key.modified;
+        header.transparent = key.transparent;
+
+        std::vector<FileEntry> entries(images.size());
+        size_t offset = AlignUp(sizeof(FileHeader) + entries.size() * sizeof(FileEntry), DataAlignment);
+        for(size_t i = 0; i < images.size(); ++i) {
+            const core::Image &image = images[i];
+            FileEntry &entry = entries[i];
+            entry.offset = offset;
+            entry.width = image.Width();
+            entry.height = image.Height();
+            entry.rowBytes = image.Width() * image.PixelStride();
+            entry.format = core::ImageFormat(image).format;
+            offset = AlignUp(offset + entry.rowBytes * entry.height, DataAlignment);
+        }
+
+        const boost::filesystem::path temp = file.parent_path() / boost::filesystem::unique_path(file.filename().string() + ".%%%%%%");
+        try {
+            boost::filesystem::ofstream fout(temp, std::ios_base::binary | std::ios_base::out);
+            if(!fout) {
+                throw std::runtime_error(strerror(errno));
+            }
+
+            const std::vector<char> padding(DataAlignment, 0);
+            size_t written = 0;
+            auto write = [&fout, &written](const char *data, size_t numBytes) {
+                fout.write(data, numBytes);
+                written += numBytes;
+            };
+
+            write(reinterpret_cast<const char*>(&header), sizeof(header));
+            write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(FileEntry));
+
+            for(size_t i = 0; i < images.size(); ++i) {
+                write(padding.data(), entries[i].offset - written);
+
+                const core::ImageLocker lock(images[i]);
+                for(size_t y = 0; y < entries[i].height; ++y) {
+                    write(lock.Data() + images[i].RowStride() * y, entries[i].rowBytes);
+                }
+            }
+
+            fout.close();
+            if(!fout) {
+                throw std::runtime_error(strerror(errno));
+            }
+
+            boost::filesystem::rename(temp, file);
+        } catch(const std::exception&) {
+            boost::system::error_code ignored;
+            boost::filesystem::remove(temp, ignored);
+            throw;
+        }
+    }
+
+    const DecodeCacheKey MakeDecodeCacheKey(const boost::filesystem::path &path, uint32_t transparent)
+    {
+        DecodeCacheKey key;
+        key.path = boost::filesystem::canonical(path).string();
+        key.fileSize = boost::filesystem::file_size(path);
+        key.modified = boost::filesystem::last_write_time(path);
+        key.transparent = transparent;
+        return key;
+    }
+
+    const boost::filesystem::path DecodeCachePath(const boost::filesystem::path &dir, const DecodeCacheKey &key)
+    {
+        std::ostringstream name;
+        name << std::hex << std::setw(16) << std::setfill('0') << HashString(key.path)
+             << '-' << std::setw(8) << key.transparent
+             << ".gm1c";
+        return dir / name.str();
+    }
+}
@@ -0,0 +1,95 @@
+#ifndef GM1CACHE_H_
+#define GM1CACHE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include <boost/filesystem/path.hpp>
+
+namespace core
+{
+    class Image;
+}
+
+namespace gm1
+{
+    class GM1Reader;
+}
+
+namespace boost
+{
+    namespace iostreams
+    {
+        class mapped_file_source;
+    }
+}
+
+namespace gm1
+{
+    /**
+     * \brief Identity of the decoded collection.
+     *
+     * Cache is considered stale when any of the fields changes.
+     */
+    struct DecodeCacheKey
+    {
+        std::string path;
+        uint64_t fileSize;
+        int64_t modified;
+        uint32_t transparent;
+    };
+
+    /**
+     * \brief Decoded entries of a collection stored on disk.
+     *
+     * Cache file is a header, an entry table and pixel rows of each entry.
+     * Pixels of each entry start on 64-byte boundary, so entries are
+     * restored by plain copying from the mapped file.
+     *
+     * \note The file is native-endian, it is not meant to be shared between machines.
+     */
+    class DecodeCache
+    {
+        struct FileHeader;
+        struct FileEntry;
+
+        std::unique_ptr<boost::iostreams::mapped_file_source> mMapping;
+        const FileEntry *mEntries;
+        size_t mNumEntries;
+
+    public:
+        DecodeCache();
+        ~DecodeCache();
+
+        /**
+         * \brief Maps the cache file.
+         *
+         * \return false if file is missing, corrupted or made for another key.
+         */
+        bool Open(const boost::filesystem::path &file, const DecodeCacheKey &key);
+        void Close();
+        bool IsOpened() const;
+
+        size_t NumEntries() const;
+        const core::Image Load(size_t index) const;
+
+        /**
+         * \brief Decodes all entries of the reader into the cache file.
+         *
+         * File is written under temporary name and renamed afterwards,
+         * so concurrent readers never see it half-written.
+         */
+        static void Write(const boost::filesystem::path &file, const DecodeCacheKey &key, const GM1Reader &reader);
+    };
+
+    const DecodeCacheKey MakeDecodeCacheKey(const boost::filesystem::path &path, uint32_t transparent);
+
+    /**
+     * \brief Name of the cache file for the key within the directory.
+     */
+    const boost::filesystem::path DecodeCachePath(const boost::filesystem::path &dir, const DecodeCacheKey &key);
+}
+
+#endif // GM1CACHE_H_
@@ -2,8 +2,8 @@
 
 #include <SDL.h>
 
-#include <boost/iostreams/device/array.hpp>
-#include <boost/iostreams/stream.hpp>
+#include <algorithm>
+#include <stdexcept>
 
 #include <core/color.h>
 #include <core/rect.h>
@@ -31,7 +31,7 @@ namespace
             return SDL_PIXELFORMAT_INDEX8;
         }
 
-        void ReadImage(std::istream &in, size_t numBytes, gm1::EntryHeader const&, core::Image &surface) const;
+        void ReadImage(const char *data, size_t numBytes, gm1::EntryHeader const&, core::Image &surface) const;
     };
 
     /**
@@ -45,13 +45,13 @@ namespace
     class TGX16 : public gm1::GM1EntryReader
     {
     protected:
-        void ReadImage(std::istream &in, size_t numBytes, gm1::EntryHeader const&, core::Image &surface) const;
+        void ReadImage(const char *data, size_t numBytes, gm1::EntryHeader const&, core::Image &surface) const;
     };
 
     class FontReader : public gm1::GM1EntryReader
     {
     protected:
-        void ReadImage(std::istream &in, size_t numBytes, gm1::EntryHeader const&, core::Image &surface) const;
+        void ReadImage(const char *data, size_t numBytes, gm1::EntryHeader const&, core::Image &surface) const;
     };
     
     /**
@@ -66,7 +66,7 @@ namespace
     class TileObject : public gm1::GM1EntryReader
     {
     protected:    
-        void ReadImage(std::istream &in, size_t numBytes, gm1::EntryHeader const&, core::Image &surface) const;
+        void ReadImage(const char *data, size_t numBytes, gm1::EntryHeader const&, core::Image &surface) const;
     };
 
     /**
@@ -80,22 +80,22 @@ namespace
             return header.height - 7;
         }
     
-        void ReadImage(std::istream &in, size_t numBytes, gm1::EntryHeader const&, core::Image &surface) const;
+        void ReadImage(const char *data, size_t numBytes, gm1::EntryHeader const&, core::Image &surface) const;
     };
     
-    void TGX8::ReadImage(std::istream &in, size_t numBytes, gm1::EntryHeader const&, core::Image &surface) const
+    void TGX8::ReadImage(const char *data, size_t numBytes, gm1::EntryHeader const&, core::Image &surface) const
     {
-        tgx::DecodeImage(in, numBytes, surface);
+        tgx::DecodeImage(data, numBytes, surface);
     }
 
-    void TGX16::ReadImage(std::istream &in, size_t numBytes, gm1::EntryHeader const&, core::Image &surface) const
+    void TGX16::ReadImage(const char *data, size_t numBytes, gm1::EntryHeader const&, core::Image &surface) const
     {
-        tgx::DecodeImage(in, numBytes, surface);
+        tgx::DecodeImage(data, numBytes, surface);
     }
 
-    void FontReader::ReadImage(std::istream &in, size_t numBytes, gm1::EntryHeader const&, core::Image &surface) const
+    void FontReader::ReadImage(const char *data, size_t numBytes, gm1::EntryHeader const&, core::Image &surface) const
     {
-        tgx::DecodeImage(in, numBytes, surface);
+        tgx::DecodeImage(data, numBytes, surface);
 
         // Originally I found that just color-keying of an image
         // doesn't work properly. After skipping all fully-transparent
@@ -120,30 +120,27 @@ namespace
         // surface = tmp;
     }
     
-    void Bitmap::ReadImage(std::istream &in, size_t numBytes, gm1::EntryHeader const&, core::Image &surface) const
+    void Bitmap::ReadImage(const char *data, size_t numBytes, gm1::EntryHeader const&, core::Image &surface) const
     {
         core::ImageLocker lock(surface);
 
         const size_t stride = surface.RowStride();
         const size_t rowBytes = surface.Width() * surface.PixelStride();
-        char *const data = lock.Data();
+        char *const pixels = lock.Data();
 
         for(size_t i = 0; (numBytes >= rowBytes) && (i < surface.Height()); ++i) {
-            in.read(data + stride * i, rowBytes);
+            std::copy(data, data + rowBytes, pixels + stride * i);
+            data += rowBytes;
             numBytes -= rowBytes;
         }
     }
     
-    // Width of rhombus rows in pixels.
-    // \todo should it be placed in separate header file?
-    constexpr uint8_t PerRow[] = {2, 6, 10, 14, 18, 22, 26, 30, 30, 26, 22, 18, 14, 10, 6, 2};
-    
     constexpr uint8_t GetTilePixelsPerRow(size_t row)
     {
-        return PerRow[row];
+        return gm1::TilePixelsPerRow[row];
     }
 
-    void ReadTile(std::istream &in, core::Image &image)
+    void ReadTile(const char *data, core::Image &image)
     {
         core::ImageLocker lock(image);
         
@@ -151,25 +148,30 @@ namespace
         const size_t height = gm1::TileSpriteHeight;
         const size_t width = gm1::TileSpriteWidth;
         const size_t pixelStride = image.PixelStride();
-        char *data = lock.Data();
+        char *pixels = lock.Data();
     
         for(size_t y = 0; y < height; ++y) {
             const size_t length = GetTilePixelsPerRow(y);
             const size_t offset = (width - length) / 2;
-            in.read(data + offset * pixelStride, length * pixelStride);
-            data += rowStride;
+            std::copy(data, data + length * pixelStride, pixels + offset * pixelStride);
+            data += length * pixelStride;
+            pixels += rowStride;
         }
     }
     
-    void TileObject::ReadImage(std::istream &in, size_t numBytes, const gm1::EntryHeader &header, core::Image &surface) const
+    void TileObject::ReadImage(const char *data, size_t numBytes, const gm1::EntryHeader &header, core::Image &surface) const
     {
+        if(numBytes < gm1::TileBytes) {
+            throw std::logic_error("Entry too small to read tile");
+        }
+        
         const core::Rect tilerect(0, header.tileY, Width(header), gm1::TileSpriteHeight);
         core::ImageView tile(surface, tilerect);
-        ReadTile(in, tile.GetView());
+        ReadTile(data, tile.GetView());
         
         const core::Rect boxrect(header.hOffset, 0, header.boxWidth, Height(header));
         core::ImageView box(surface, boxrect);
-        tgx::DecodeImage(in, numBytes - gm1::TileBytes, box.GetView());
+        tgx::DecodeImage(data + gm1::TileBytes, numBytes - gm1::TileBytes, box.GetView());
     }
 }
 
@@ -190,8 +192,7 @@ namespace gm1
         core::Image image = CreateCompatibleImage(header);
         core::ClearImage(image, mTransparentColor);
         image.SetColorKey(mTransparentColor);
-        boost::iostreams::stream<boost::iostreams::array_source> in(data, bytesCount);
-        ReadImage(in, bytesCount, header, image);
+        ReadImage(data, bytesCount, header, image);
         return image;
     }
     
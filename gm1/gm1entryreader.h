@@ -1,7 +1,7 @@
 #ifndef GM1ENTRYREADER_H_
 #define GM1ENTRYREADER_H_
 
-#include <iosfwd>
+#include <cstddef>
 #include <memory>
 
 #include <core/color.h>
@@ -29,7 +29,7 @@ namespace gm1
         uint32_t GetColorKey(uint32_t format) const;
         
     protected:
-        virtual void ReadImage(std::istream &in, size_t numBytes, const gm1::EntryHeader &header, core::Image &surface) const = 0;
+        virtual void ReadImage(const char *data, size_t numBytes, const gm1::EntryHeader &header, core::Image &surface) const = 0;
         virtual int Width(const gm1::EntryHeader &header) const;
         virtual int Height(const gm1::EntryHeader &header) const;
         virtual uint32_t SourcePixelFormat() const;
@@ -0,0 +1,331 @@
+#include "gm1entrywriter.h"
+
+#include <SDL.h>
+
+#include <algorithm>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+#include <core/color.h>
+#include <core/rect.h>
+#include <core/palette.h>
+#include <core/image.h>
+#include <core/imageview.h>
+#include <core/imagelocker.h>
+#include <core/pixelformat.h>
+
+#include <gm1/gm1.h>
+#include <tgx/tgx.h>
+
+namespace
+{
+    /**
+     * \brief Writer for animation sprites.
+     *
+     * Colors are mapped onto the palette, the nearest one is
+     * taken if there is no exact match.
+     */
+    class TGX8 : public gm1::GM1EntryWriter
+    {
+        core::Palette mPalette;
+        std::vector<int> mIndices;
+        const SDL_PixelFormat &mPaletteFormat;
+
+        int NearestIndex(const core::Color &color) const;
+        int MapColor(const core::Color &color) const;
+
+    protected:
+        uint32_t TargetPixelFormat() const {
+            return SDL_PIXELFORMAT_ARGB8888;
+        }
+
+        void WriteImage(std::ostream &out, const core::Image &image, gm1::EntryHeader &header) const;
+
+    public:
+        TGX8();
+        void Palette(const core::Palette &palette);
+    };
+
+    /**
+     * \brief Writer for static textures and fonts.
+     */
+    class TGX16 : public gm1::GM1EntryWriter
+    {
+    protected:
+        void WriteImage(std::ostream &out, const core::Image &image, gm1::EntryHeader &header) const;
+    };
+
+    /**
+     * \brief Writer for tile textures.
+     *
+     * Entry header should already contain tile placement
+     * (`tileY', `hOffset' and `boxWidth').
+     */
+    class TileObject : public gm1::GM1EntryWriter
+    {
+    protected:
+        void WriteImage(std::ostream &out, const core::Image &image, gm1::EntryHeader &header) const;
+    };
+
+    class Bitmap : public gm1::GM1EntryWriter
+    {
+    protected:
+        void WriteImage(std::ostream &out, const core::Image &image, gm1::EntryHeader &header) const;
+    };
+
+    TGX8::TGX8()
+        : mIndices(1 << 15, -1)
+        , mPaletteFormat(core::GetPixelFormat(gm1::PalettePixelFormat))
+    {
+    }
+
+    void TGX8::Palette(const core::Palette &palette)
+    {
+        mPalette = core::Palette(palette.Size());
+        std::copy(palette.begin(), palette.end(), mPalette.begin());
+
+        std::fill(mIndices.begin(), mIndices.end(), -1);
+        for(size_t i = 0; i < mPalette.Size(); ++i) {
+            int &index = mIndices[core::Color(mPalette[i]).ConvertTo(mPaletteFormat)];
+            if(index < 0) {
+                index = i;
+            }
+        }
+    }
+
+    int TGX8::NearestIndex(const core::Color &color) const
+    {
+        int nearest = 0;
+        int minDistance = std::numeric_limits<int>::max();
+        for(size_t i = 0; i < mPalette.Size(); ++i) {
+            const int dr = mPalette[i].r - color.r;
+            const int dg = mPalette[i].g - color.g;
+            const int db = mPalette[i].b - color.b;
+            const int distance = dr * dr + dg * dg + db * db;
+            if(distance < minDistance) {
+                minDistance = distance;
+                nearest = i;
+            }
+        }
+        return nearest;
+    }
+
+    int TGX8::MapColor(const core::Color &color) const
+    {
+        const int index = mIndices[color.ConvertTo(mPaletteFormat)];
+        if(index >= 0) {
+            return index;
+        }
+        return NearestIndex(color);
+    }
+
+    void TGX8::WriteImage(std::ostream &out, const core::Image &image, gm1::EntryHeader &header) const
+    {
+        if(mPalette.Null() || mPalette.Size() == 0) {
+            throw std::logic_error("Palette is required to write 8-bit entries");
+        }
+
+        const size_t width = image.Width();
+        const size_t height = image.Height();
+        const uint32_t transparent = Transparent().ConvertTo(mPaletteFormat);
+
+        // Indices are evaluated first so we could pick a free one for transparency.
+        std::vector<int> indices(width * height);
+        std::vector<bool> used(256, false);
+        {
+            const core::ImageLocker lock(image);
+            const SDL_PixelFormat &format = core::ImageFormat(image);
+            const size_t pixelStride = image.PixelStride();
+            for(size_t y = 0; y < height; ++y) {
+                const char *pixels = lock.Data() + image.RowStride() * y;
+                for(size_t x = 0; x < width; ++x) {
+                    const core::Color color = core::PixelToColor(core::GetPackedPixel(pixels + x * pixelStride, pixelStride), format);
+                    int &index = indices[y * width + x];
+                    if(color.a == 0 || color.ConvertTo(mPaletteFormat) == transparent) {
+                        index = -1;
+                    } else {
+                        index = MapColor(color);
+                        used[index] = true;
+                    }
+                }
+            }
+        }
+
+        // Key out of 8-bit range matches no pixel, so fully opaque entry may use all 256 indices.
+        uint32_t colorKey = UINT8_MAX + 1;
+        if(std::any_of(indices.begin(), indices.end(), [](int index) { return index < 0; })) {
+            const auto unused = std::find(used.begin(), used.end(), false);
+            if(unused == used.end()) {
+                throw std::logic_error("No free palette index left for transparent pixels");
+            }
+            colorKey = std::distance(used.begin(), unused);
+        }
+
+        std::vector<char> buffer(indices.size());
+        std::transform(indices.begin(), indices.end(), buffer.begin(), [colorKey](int index) {
+                return static_cast<char>(index < 0 ? colorKey : index);
+            });
+
+        header.width = width;
+        header.height = height;
+        tgx::EncodeBuffer(out, buffer.data(), width, height, width, 1, colorKey, Encoding());
+    }
+
+    void TGX16::WriteImage(std::ostream &out, const core::Image &image, gm1::EntryHeader &header) const
+    {
+        header.width = image.Width();
+        header.height = image.Height();
+        tgx::EncodeImage(out, image, Encoding());
+    }
+
+    void Bitmap::WriteImage(std::ostream &out, const core::Image &image, gm1::EntryHeader &header) const
+    {
+        const core::ImageLocker lock(image);
+
+        const size_t rowBytes = image.Width() * image.PixelStride();
+        for(size_t y = 0; y < image.Height(); ++y) {
+            out.write(lock.Data() + image.RowStride() * y, rowBytes);
+        }
+
+        header.width = image.Width();
+        // See GM1EntryReader
+        header.height = image.Height() + 7;
+    }
+
+    void WriteTile(std::ostream &out, const core::Image &image)
+    {
+        const core::ImageLocker lock(image);
+
+        const size_t pixelStride = image.PixelStride();
+        const char *pixels = lock.Data();
+
+        for(size_t y = 0; y < gm1::TileSpriteHeight; ++y) {
+            const size_t length = gm1::TilePixelsPerRow[y];
+            const size_t offset = (gm1::TileSpriteWidth - length) / 2;
+            out.write(pixels + offset * pixelStride, length * pixelStride);
+            pixels += image.RowStride();
+        }
+    }
+
+    // Pixels of the box which lie over the tile rhombus would be
+    // overdrawn with the very same pixels, so we skip them.
+    void EraseTile(core::Image &box, int tileX, int tileY, const core::Color &color)
+    {
+        core::ImageLocker lock(box);
+
+        const uint32_t colorKey = color.ConvertTo(core::ImageFormat(box));
+        const size_t pixelStride = box.PixelStride();
+        for(size_t y = 0; y < gm1::TileSpriteHeight; ++y) {
+            const int row = tileY + y;
+            if(row < 0 || static_cast<size_t>(row) >= box.Height()) {
+                continue;
+            }
+            const int length = gm1::TilePixelsPerRow[y];
+            const int first = tileX + (gm1::TileSpriteWidth - length) / 2;
+            const int begin = std::max(0, first);
+            const int end = std::min<int>(box.Width(), first + length);
+            char *pixels = lock.Data() + box.RowStride() * row;
+            for(int x = begin; x < end; ++x) {
+                core::SetPackedPixel(pixels + x * pixelStride, colorKey, pixelStride);
+            }
+        }
+    }
+
+    void TileObject::WriteImage(std::ostream &out, const core::Image &image, gm1::EntryHeader &header) const
+    {
+        if(image.Width() != gm1::TileSpriteWidth) {
+            throw std::logic_error("Tile object should be exactly 30 pixels wide");
+        }
+
+        if(header.tileY < 0 || image.Height() < header.tileY + gm1::TileSpriteHeight) {
+            throw std::logic_error("Tile object is too small to contain tile");
+        }
+
+        if(header.hOffset + header.boxWidth > image.Width()) {
+            throw std::logic_error("Tile box exceeds image bounds");
+        }
+
+        header.width = image.Width();
+        header.height = image.Height();
+
+        const core::Rect tilerect(0, header.tileY, gm1::TileSpriteWidth, gm1::TileSpriteHeight);
+        const core::ImageView tile(image, tilerect);
+        WriteTile(out, tile.GetView());
+
+        const core::Rect boxrect(header.hOffset, 0, header.boxWidth, image.Height());
+        const core::ImageView view(image, boxrect);
+        core::Image box = core::ConvertImage(view.GetView(), core::ImageFormat(image));
+        box.SetColorKey(Transparent());
+        EraseTile(box, -header.hOffset, header.tileY, Transparent());
+        tgx::EncodeImage(out, box, Encoding());
+    }
+}
+
+namespace gm1
+{
+    GM1EntryWriter::GM1EntryWriter()
+        : mTransparentColor(255, 0, 255, 255)
+        , mEncoding(tgx::Encoding::Greedy)
+    {
+    }
+
+    void GM1EntryWriter::Save(std::ostream &out, const core::Image &image, gm1::EntryHeader &header) const
+    {
+        core::Image converted = core::ConvertImage(image, TargetPixelFormat());
+        converted.SetColorKey(mTransparentColor);
+        WriteImage(out, converted, header);
+    }
+
+    uint32_t GM1EntryWriter::TargetPixelFormat() const
+    {
+        return tgx::PixelFormat;
+    }
+
+    const core::Color GM1EntryWriter::Transparent() const
+    {
+        return mTransparentColor;
+    }
+
+    void GM1EntryWriter::Transparent(core::Color color)
+    {
+        mTransparentColor = std::move(color);
+    }
+
+    tgx::Encoding GM1EntryWriter::Encoding() const
+    {
+        return mEncoding;
+    }
+
+    void GM1EntryWriter::Encoding(tgx::Encoding encoding)
+    {
+        mEncoding = encoding;
+    }
+
+    void GM1EntryWriter::Palette(const core::Palette&)
+    {
+    }
+
+    GM1EntryWriter::Ptr CreateEntryWriter(const ArchiveType &type)
+    {
+        switch(type) {
+        case ArchiveType::Font:
+        case ArchiveType::TGX16:
+            return GM1EntryWriter::Ptr(new TGX16);
+
+        case ArchiveType::Bitmap:
+            return GM1EntryWriter::Ptr(new Bitmap);
+
+        case ArchiveType::TGX8:
+            return GM1EntryWriter::Ptr(new TGX8);
+
+        case ArchiveType::TileObject:
+            return GM1EntryWriter::Ptr(new TileObject);
+
+        case ArchiveType::Unknown:
+        default:
+            throw std::runtime_error("Unknown encoding");
+        }
+    }
+}
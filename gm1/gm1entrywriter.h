@@ -0,0 +1,77 @@
+#ifndef GM1ENTRYWRITER_H_
+#define GM1ENTRYWRITER_H_
+
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+
+#include <core/color.h>
+
+namespace gm1
+{
+    class EntryHeader;
+    enum class ArchiveType;
+}
+
+namespace core
+{
+    class Image;
+    class Palette;
+}
+
+namespace tgx
+{
+    enum class Encoding;
+}
+
+namespace gm1
+{
+    /**
+     * \brief Inverse of GM1EntryReader.
+     *
+     * Pixels of the transparent color are left out of the entry data.
+     */
+    class GM1EntryWriter
+    {
+        core::Color mTransparentColor;
+        tgx::Encoding mEncoding;
+
+    protected:
+        virtual void WriteImage(std::ostream &out, const core::Image &image, gm1::EntryHeader &header) const = 0;
+        virtual uint32_t TargetPixelFormat() const;
+
+    public:
+        GM1EntryWriter();
+        virtual ~GM1EntryWriter() = default;
+
+        void Transparent(core::Color color);
+        const core::Color Transparent() const;
+
+        /**
+         * \brief Sets how tgx entries are split into tokens.
+         */
+        void Encoding(tgx::Encoding encoding);
+        tgx::Encoding Encoding() const;
+
+        /**
+         * \brief Sets palette which indexed entries are mapped onto.
+         */
+        virtual void Palette(const core::Palette &palette);
+
+        /**
+         * \brief Encodes image as an entry of the collection.
+         *
+         * Header fields which depend on image dimensions are updated,
+         * the rest of them are taken as is.
+         *
+         * \note It is safe to call Save concurrently.
+         */
+        void Save(std::ostream &out, const core::Image &image, gm1::EntryHeader &header) const;
+
+        typedef std::unique_ptr<GM1EntryWriter> Ptr;
+    };
+
+    GM1EntryWriter::Ptr CreateEntryWriter(const gm1::ArchiveType &type);
+}
+
+#endif  // GM1ENTRYWRITER_H_
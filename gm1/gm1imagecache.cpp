@@ -0,0 +1,193 @@
+#include "gm1imagecache.h"
+
+#include <algorithm>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+#include <core/image.h>
+#include <core/imagelocker.h>
+
+namespace
+{
+    size_t ImageBytes(const core::Image &image)
+    {
+        return image.RowStride() * image.Height();
+    }
+
+    const core::Image DuplicateImage(const core::Image &image)
+    {
+        core::Image copy = core::CreateImage(image.Width(), image.Height(), core::ImageFormat(image).format);
+
+        const core::ImageLocker source(image);
+        core::ImageLocker target(copy);
+        const size_t rowBytes = image.Width() * image.PixelStride();
+        for(size_t y = 0; y < image.Height(); ++y) {
+            const char *row = source.Data() + image.RowStride() * y;
+            std::copy(row, row + rowBytes, target.Data() + copy.RowStride() * y);
+        }
+
+        if(image.ColorKeyEnabled()) {
+            copy.SetColorKey(image.GetColorKey());
+        }
+        return copy;
+    }
+}
+
+namespace gm1
+{
+    class ImageCache::Shard
+    {
+        typedef std::pair<size_t, core::Image> Item;
+        typedef std::list<Item> ItemList;
+
+        std::mutex mMutex;
+        // Most recently used items go first
+        ItemList mItems;
+        std::unordered_map<size_t, ItemList::iterator> mLookup;
+        size_t mBytes;
+        const size_t mShare;
+        const size_t mBudget;
+        std::atomic<size_t> &mTotalBytes;
+
+    public:
+        Shard(size_t share, size_t budget, std::atomic<size_t> &totalBytes)
+            : mMutex()
+            , mItems()
+            , mLookup()
+            , mBytes(0)
+            , mShare(share)
+            , mBudget(budget)
+            , mTotalBytes(totalBytes)
+        {
+        }
+
+        bool Lookup(size_t index, core::Image &image)
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            const auto found = mLookup.find(index);
+            if(found == mLookup.end()) {
+                return false;
+            }
+
+            mItems.splice(mItems.begin(), mItems, found->second);
+            image = DuplicateImage(found->second->second);
+            return true;
+        }
+
+        size_t Insert(size_t index, const core::Image &image)
+        {
+            const size_t bytes = ImageBytes(image);
+            if(bytes > mBudget) {
+                return 0;
+            }
+
+            // Copying is done before taking the lock
+            core::Image copy = DuplicateImage(image);
+
+            std::lock_guard<std::mutex> lock(mMutex);
+            if(mLookup.count(index) != 0) {
+                // Another thread was faster
+                return 0;
+            }
+
+            mItems.emplace_front(index, copy);
+            mLookup[index] = mItems.begin();
+            mBytes += bytes;
+            mTotalBytes += bytes;
+            copy = core::Image();
+
+            // Image larger than the share pushes out everything else of the shard.
+            // The new one goes last, when other shards hold the rest of budget.
+            size_t evicted = 0;
+            while(!mItems.empty() && ((mBytes > mShare && mItems.size() > 1) || mTotalBytes > mBudget)) {
+                const Item &last = mItems.back();
+                const size_t lastBytes = ImageBytes(last.second);
+                mBytes -= lastBytes;
+                mTotalBytes -= lastBytes;
+                mLookup.erase(last.first);
+                mItems.pop_back();
+                ++evicted;
+            }
+            return evicted;
+        }
+
+        void Clear()
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mLookup.clear();
+            mItems.clear();
+            mTotalBytes -= mBytes;
+            mBytes = 0;
+        }
+
+        void Collect(ImageCacheStats &stats)
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            stats.entries += mItems.size();
+            stats.bytes += mBytes;
+        }
+    };
+
+    ImageCache::ImageCache(size_t budget, size_t numShards)
+        : mShards()
+        , mBudget(budget)
+        , mBytes(0)
+        , mHits(0)
+        , mMisses(0)
+        , mEvictions(0)
+    {
+        numShards = std::max<size_t>(1, numShards);
+        mShards.reserve(numShards);
+        for(size_t i = 0; i < numShards; ++i) {
+            mShards.emplace_back(new Shard(budget / numShards, budget, mBytes));
+        }
+    }
+
+    ImageCache::~ImageCache() = default;
+
+    ImageCache::Shard& ImageCache::GetShard(size_t index) const
+    {
+        return *mShards[index % mShards.size()];
+    }
+
+    bool ImageCache::Lookup(size_t index, core::Image &image)
+    {
+        if(GetShard(index).Lookup(index, image)) {
+            ++mHits;
+            return true;
+        }
+        ++mMisses;
+        return false;
+    }
+
+    void ImageCache::Insert(size_t index, const core::Image &image)
+    {
+        mEvictions += GetShard(index).Insert(index, image);
+    }
+
+    void ImageCache::Clear()
+    {
+        for(const std::unique_ptr<Shard> &shard : mShards) {
+            shard->Clear();
+        }
+    }
+
+    size_t ImageCache::Budget() const
+    {
+        return mBudget;
+    }
+
+    const ImageCacheStats ImageCache::Stats() const
+    {
+        ImageCacheStats stats = ImageCacheStats();
+        stats.hits = mHits;
+        stats.misses = mMisses;
+        stats.evictions = mEvictions;
+        for(const std::unique_ptr<Shard> &shard : mShards) {
+            shard->Collect(stats);
+        }
+        return stats;
+    }
+}
@@ -0,0 +1,69 @@
+#ifndef GM1IMAGECACHE_H_
+#define GM1IMAGECACHE_H_
+
+#include <cstddef>
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace core
+{
+    class Image;
+}
+
+namespace gm1
+{
+    struct ImageCacheStats
+    {
+        size_t hits;
+        size_t misses;
+        size_t evictions;
+        size_t entries;
+        size_t bytes;
+    };
+
+    /**
+     * \brief Decoded entries bounded by total size of pixels.
+     *
+     * Entries are spread over independently locked shards, each of them
+     * evicts least recently used entries once its share of budget is exceeded.
+     * Entry larger than the share is kept alone in its shard as long as
+     * the total budget allows it.
+     *
+     * Images are deep copied in both directions, so no surface is ever
+     * shared between threads (SDL_Surface refcount isn't atomic).
+     */
+    class ImageCache
+    {
+        class Shard;
+
+        std::vector<std::unique_ptr<Shard>> mShards;
+        const size_t mBudget;
+        std::atomic<size_t> mBytes;
+        std::atomic<size_t> mHits;
+        std::atomic<size_t> mMisses;
+        std::atomic<size_t> mEvictions;
+
+        Shard& GetShard(size_t index) const;
+
+    public:
+        explicit ImageCache(size_t budget, size_t numShards = 16);
+        ~ImageCache();
+
+        /**
+         * \brief Copies cached entry into image.
+         *
+         * \return false if entry is missing.
+         */
+        bool Lookup(size_t index, core::Image &image);
+
+        void Insert(size_t index, const core::Image &image);
+        void Clear();
+
+        size_t Budget() const;
+        const ImageCacheStats Stats() const;
+    };
+}
+
+#endif // GM1IMAGECACHE_H_
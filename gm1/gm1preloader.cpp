@@ -0,0 +1,186 @@
+#include "gm1preloader.h"
+
+#include <algorithm>
+
+namespace gm1
+{
+    PreloadCancelled::PreloadCancelled()
+        : std::runtime_error("Preload task was cancelled")
+    {
+    }
+
+    Preloader::Preloader(size_t numThreads)
+        : mMutex()
+        , mWakeUp()
+        , mQueue()
+        , mTasks()
+        , mNextId(0)
+        , mStopping(false)
+        , mThreads()
+    {
+        numThreads = std::max<size_t>(1, numThreads);
+        for(size_t i = 0; i < numThreads; ++i) {
+            mThreads.emplace_back(&Preloader::Worker, this);
+        }
+    }
+
+    Preloader::~Preloader()
+    {
+        std::unordered_map<TaskId, QueuedTask> cancelled;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mStopping = true;
+            mQueue.clear();
+            cancelled.swap(mTasks);
+        }
+        mWakeUp.notify_all();
+
+        for(auto &task : cancelled) {
+            task.second.cancel();
+        }
+
+        for(std::thread &thread : mThreads) {
+            thread.join();
+        }
+    }
+
+    Preloader::TaskId Preloader::Push(int priority, std::function<void()> run, std::function<void()> cancel)
+    {
+        TaskId id;
+        bool queued = false;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            id = mNextId++;
+            if(!mStopping) {
+                mTasks[id] = QueuedTask {priority, std::move(run), std::move(cancel)};
+                mQueue[QueueKey(priority, id)] = id;
+                queued = true;
+            }
+        }
+
+        if(!queued) {
+            // Callbacks may still queue tasks while preloader is being destroyed
+            cancel();
+        } else {
+            mWakeUp.notify_one();
+        }
+        return id;
+    }
+
+    void Preloader::Worker()
+    {
+        for(;;) {
+            std::function<void()> run;
+            {
+                std::unique_lock<std::mutex> lock(mMutex);
+                mWakeUp.wait(lock, [this]() {
+                        return mStopping || !mQueue.empty();
+                    });
+                if(mQueue.empty()) {
+                    return;
+                }
+
+                const TaskId id = mQueue.begin()->second;
+                mQueue.erase(mQueue.begin());
+
+                const auto found = mTasks.find(id);
+                run = std::move(found->second.run);
+                mTasks.erase(found);
+            }
+            run();
+        }
+    }
+
+    bool Preloader::Cancel(TaskId id)
+    {
+        std::function<void()> cancel;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            const auto found = mTasks.find(id);
+            if(found == mTasks.end()) {
+                return false;
+            }
+            mQueue.erase(QueueKey(found->second.priority, id));
+            cancel = std::move(found->second.cancel);
+            mTasks.erase(found);
+        }
+        cancel();
+        return true;
+    }
+
+    bool Preloader::SetPriority(TaskId id, int priority)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        const auto found = mTasks.find(id);
+        if(found == mTasks.end()) {
+            return false;
+        }
+
+        mQueue.erase(QueueKey(found->second.priority, id));
+        found->second.priority = priority;
+        mQueue[QueueKey(priority, id)] = id;
+        return true;
+    }
+
+    size_t Preloader::NumPending() const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mTasks.size();
+    }
+
+    Preloader::Task<std::shared_future<Preloader::ReaderPtr>> Preloader::Open(const boost::filesystem::path &path,
+                                                                              GM1Reader::Flags flags,
+                                                                              int priority,
+                                                                              OpenCallback done)
+    {
+        auto promise = std::make_shared<std::promise<ReaderPtr>>();
+        std::shared_future<ReaderPtr> result = promise->get_future().share();
+
+        auto run = [promise, path, flags, done]() {
+            ReaderPtr reader;
+            try {
+                reader = std::make_shared<GM1Reader>();
+                reader->Open(path, flags);
+            } catch(...) {
+                promise->set_exception(std::current_exception());
+                return;
+            }
+            promise->set_value(reader);
+            if(done) {
+                done(reader);
+            }
+        };
+
+        auto cancel = [promise]() {
+            promise->set_exception(std::make_exception_ptr(PreloadCancelled()));
+        };
+
+        const TaskId id = Push(priority, run, cancel);
+        return Task<std::shared_future<ReaderPtr>> {id, result};
+    }
+
+    Preloader::Task<std::future<core::Image>> Preloader::ReadEntry(const ReaderPtr &reader, size_t index, int priority)
+    {
+        if(!reader) {
+            throw std::invalid_argument("Reader is null");
+        }
+
+        auto promise = std::make_shared<std::promise<core::Image>>();
+        std::future<core::Image> result = promise->get_future();
+
+        auto run = [promise, reader, index]() {
+            try {
+                promise->set_value(reader->ReadEntry(index));
+            } catch(...) {
+                promise->set_exception(std::current_exception());
+            }
+        };
+
+        auto cancel = [promise]() {
+            promise->set_exception(std::make_exception_ptr(PreloadCancelled()));
+        };
+
+        const TaskId id = Push(priority, run, cancel);
+        return Task<std::future<core::Image>> {id, std::move(result)};
+    }
+}
@@ -0,0 +1,129 @@
+#ifndef GM1PRELOADER_H_
+#define GM1PRELOADER_H_
+
+#include <cstddef>
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <boost/filesystem/path.hpp>
+
+#include <core/image.h>
+#include <core/parallel.h>
+
+#include <gm1/gm1reader.h>
+
+namespace gm1
+{
+    /**
+     * \brief Result of a task which was cancelled before it started.
+     */
+    class PreloadCancelled : public std::runtime_error
+    {
+    public:
+        PreloadCancelled();
+    };
+
+    /**
+     * \brief Opens collections and decodes entries in background.
+     *
+     * Tasks are run by a fixed pool of threads, higher priority first and
+     * in order of submission among equal priorities. Queued tasks can be
+     * cancelled or reprioritized; running tasks are always completed.
+     *
+     * Errors are delivered through futures as well as results.
+     *
+     * \code
+     * gm1::Preloader preloader;
+     * auto open = preloader.Open(path, gm1::GM1Reader::Mapped, 0,
+     *     [&preloader](const gm1::Preloader::ReaderPtr &reader) {
+     *         preloader.ReadEntry(reader, 0, 10);
+     *     });
+     * \endcode
+     */
+    class Preloader
+    {
+    public:
+        typedef size_t TaskId;
+        typedef std::shared_ptr<GM1Reader> ReaderPtr;
+        typedef std::function<void(const ReaderPtr&)> OpenCallback;
+
+        template<class Result>
+        struct Task
+        {
+            TaskId id;
+            Result result;
+        };
+
+        explicit Preloader(size_t numThreads = core::HardwareConcurrency());
+
+        /**
+         * Queued tasks are cancelled, running tasks are waited for.
+         */
+        ~Preloader();
+
+        /**
+         * \param done  Called on the worker thread once the collection is opened,
+         *              it may queue more tasks but should not throw.
+         */
+        Task<std::shared_future<ReaderPtr>> Open(const boost::filesystem::path &path,
+                                                  GM1Reader::Flags flags,
+                                                  int priority = 0,
+                                                  OpenCallback done = OpenCallback());
+
+        /**
+         * Image is moved into the future, so it is safe to take it on another thread.
+         */
+        Task<std::future<core::Image>> ReadEntry(const ReaderPtr &reader, size_t index, int priority = 0);
+
+        /**
+         * \return false if task is already running or completed.
+         */
+        bool Cancel(TaskId id);
+        bool SetPriority(TaskId id, int priority);
+
+        size_t NumPending() const;
+
+    private:
+        // Higher priority goes first, then the earlier submitted
+        typedef std::pair<int, TaskId> QueueKey;
+
+        struct QueueOrder
+        {
+            bool operator()(const QueueKey &lhs, const QueueKey &rhs) const {
+                return (lhs.first != rhs.first)
+                    ? (lhs.first > rhs.first)
+                    : (lhs.second < rhs.second);
+            }
+        };
+
+        struct QueuedTask
+        {
+            int priority;
+            std::function<void()> run;
+            std::function<void()> cancel;
+        };
+
+        mutable std::mutex mMutex;
+        std::condition_variable mWakeUp;
+        std::map<QueueKey, TaskId, QueueOrder> mQueue;
+        std::unordered_map<TaskId, QueuedTask> mTasks;
+        TaskId mNextId;
+        bool mStopping;
+        std::vector<std::thread> mThreads;
+
+        TaskId Push(int priority, std::function<void()> run, std::function<void()> cancel);
+        void Worker();
+    };
+}
+
+#endif // GM1PRELOADER_H_
@@ -3,20 +3,33 @@
 #include <cerrno>
 #include <cstring>
 
+#include <algorithm>
 #include <vector>
 
 #include <boost/filesystem/operations.hpp>
 #include <boost/filesystem/fstream.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
 
 #include <core/iohelpers.h>
+#include <core/parallel.h>
 #include <core/color.h>
 #include <core/palette.h>
+#include <core/pixelconvert.h>
 #include <core/image.h>
+#include <core/imagelocker.h>
+#include <core/rlesprite.h>
 
+#include <gm1/gm1cache.h>
 #include <gm1/gm1entryreader.h>
 
+#include <tgx/tgx.h>
+
 namespace
 {
+    // Holes between entries up to this size are read rather than seeked over
+    const size_t MaxReadGap = 4096;
+    const size_t MaxReadSize = 16 << 20;
+
     std::istream& ReadHeader(std::istream &in, gm1::Header &header)
     {
         core::ReadLittle(in, header.u1);
@@ -44,43 +57,48 @@ namespace
         return in;
     }
 
-    std::istream& ReadPalette(std::istream &in, core::Palette &palette)
+    template<class T>
+    const char* ParseTable(const char *data, std::vector<T> &table)
     {
-        for(core::Palette::value_type &entry : palette) {
-            uint16_t pixel;
-            core::ReadLittle<uint16_t>(in, pixel);
-            entry = core::PixelToColor(pixel, gm1::PalettePixelFormat);
+        std::copy(data, data + table.size() * sizeof(T), reinterpret_cast<char*>(table.data()));
+        for(T &value : table) {
+            value = core::SwapLittle(value);
         }
-        return in;
+        return data + table.size() * sizeof(T);
     }
 
-    std::istream& ReadEntryHeader(std::istream &in, gm1::EntryHeader &header)
+    const char* ParsePalette(const char *data, core::Palette &palette)
     {
-        core::ReadLittle(in, header.width);
-        core::ReadLittle(in, header.height);
-        core::ReadLittle(in, header.posX);
-        core::ReadLittle(in, header.posY);
-        core::ReadLittle(in, header.group);
-        core::ReadLittle(in, header.groupSize);
-        core::ReadLittle(in, header.tileY);
-        core::ReadLittle(in, header.tileOrient);
-        core::ReadLittle(in, header.hOffset);
-        core::ReadLittle(in, header.boxWidth);
-        core::ReadLittle(in, header.flags);
-        return in;
+        std::vector<uint16_t> pixels(palette.Size());
+        data = ParseTable(data, pixels);
+
+        std::vector<uint32_t> colors(pixels.size());
+        core::ConvertRGB555ToARGB8888(pixels.data(), colors.data(), pixels.size());
+        std::transform(colors.begin(), colors.end(), palette.begin(), [](uint32_t argb) {
+                return core::Color(argb >> 16, argb >> 8, argb, argb >> 24);
+            });
+        return data;
+    }
+
+    static_assert(sizeof(gm1::EntryHeader) == gm1::CollectionEntryHeaderBytes,
+                  "EntryHeader should match its on-disk layout");
+
+    const char* ParseEntryHeaders(const char *data, std::vector<gm1::EntryHeader> &headers)
+    {
+        std::copy(data, data + headers.size() * sizeof(gm1::EntryHeader), reinterpret_cast<char*>(headers.data()));
+        for(gm1::EntryHeader &header : headers) {
+            header.width = core::SwapLittle(header.width);
+            header.height = core::SwapLittle(header.height);
+            header.posX = core::SwapLittle(header.posX);
+            header.posY = core::SwapLittle(header.posY);
+            header.tileY = core::SwapLittle(header.tileY);
+        }
+        return data + headers.size() * sizeof(gm1::EntryHeader);
     }
 }
 
 namespace gm1
 {
-    struct ReaderEntryData
-    {
-        EntryHeader header;
-        uint32_t size;
-        uint32_t offset;
-        mutable std::vector<char> buffer;
-    };
-    
     GM1Reader::~GM1Reader() = default;
     GM1Reader::GM1Reader(const boost::filesystem::wpath& path, Flags flags)
         : mIsOpened(false)
@@ -88,8 +106,16 @@ namespace gm1
         , mDataOffset(0)
         , mHeader()
         , mPalettes()
-        , mEntries()
+        , mOffsets()
+        , mSizes()
+        , mEntryHeaders()
+        , mBuffers()
         , mEntryReader()
+        , mMapping()
+        , mCacheDir()
+        , mCache()
+        , mImageCache()
+        , mBufferMutex()
     {
         if(boost::filesystem::exists(path)) {
             Open(path, flags);
@@ -105,8 +131,16 @@ namespace gm1
     {
         mIsOpened = false;
         mPalettes.resize(0);
-        mEntries.resize(0);
+        mOffsets.clear();
+        mSizes.clear();
+        mEntryHeaders.clear();
+        mBuffers.clear();
         mDataOffset = 0;
+        mMapping.reset();
+        mCache.reset();
+        if(mImageCache) {
+            mImageCache->Clear();
+        }
         
         boost::filesystem::ifstream fis(path, std::ios_base::binary);
         if(!fis.is_open()) {
@@ -127,50 +161,57 @@ namespace gm1
 
         if(fsize < GetPreambleSize(mHeader)) {
             throw std::logic_error("File to small to read preamble");
-        } 
+        }
+
+        // The rest of preamble is read at once and parsed in memory
+        std::vector<char> preamble(GetPreambleSize(mHeader) - gm1::CollectionHeaderBytes);
+        if(!fis.read(preamble.data(), preamble.size())) {
+            throw std::runtime_error(strerror(errno));
+        }
+
+        const char *data = preamble.data();
         mPalettes.reserve(CollectionPaletteCount);
         for(size_t i = 0; i < CollectionPaletteCount; ++i) {
             core::Palette palette(CollectionPaletteColors);
-            if(!ReadPalette(fis, palette)) {
-                throw std::runtime_error(strerror(errno));
-            }
+            data = ParsePalette(data, palette);
             mPalettes.push_back(palette);
         }
 
-        mEntries.resize(mHeader.imageCount);
-        for(ReaderEntryData &data : mEntries) {
-            core::ReadLittle(fis, data.offset);
-        }
-        if(!fis) {
-            throw std::runtime_error(strerror(errno));
-        }
-        
-        for(ReaderEntryData &data : mEntries) {
-            core::ReadLittle(fis, data.size);
-        }
-        if(!fis) {
-            throw std::runtime_error(strerror(errno));
-        }
-        
-        for(ReaderEntryData &data : mEntries) {
-            if(!ReadEntryHeader(fis, data.header)) {
-                throw std::runtime_error(strerror(errno));
-            }
-        }
+        mOffsets.resize(mHeader.imageCount);
+        mSizes.resize(mHeader.imageCount);
+        mEntryHeaders.resize(mHeader.imageCount);
+        data = ParseTable(data, mOffsets);
+        data = ParseTable(data, mSizes);
+        data = ParseEntryHeaders(data, mEntryHeaders);
 
         if(fsize < mHeader.dataSize) {
             throw std::logic_error("File too small to read data");
         }
 
         mDataOffset = fis.tellg();
-        if(flags & Cached) {
-            for(ReaderEntryData &entry : mEntries) {
-                fis.seekg(mDataOffset + entry.offset, std::ios_base::beg);
-                entry.buffer.resize(entry.size);
-                fis.read(entry.buffer.data(), entry.size);
+        if(flags & Mapped) {
+            std::unique_ptr<boost::iostreams::mapped_file_source> mapping(
+                new boost::iostreams::mapped_file_source(path));
+
+            // Entries are checked once, so EntryData may return pointers into mapping as is.
+            for(size_t i = 0; i < mHeader.imageCount; ++i) {
+                const size_t begin = mDataOffset + mOffsets[i];
+                if((begin > mapping->size()) || (mSizes[i] > mapping->size() - begin)) {
+                    throw std::logic_error("Entry exceeds file bounds");
+                }
             }
-            if(!fis) {
-                throw std::runtime_error(strerror(errno));
+            mMapping = std::move(mapping);
+        } else {
+            mBuffers.resize(mHeader.imageCount);
+            if(flags & Cached) {
+                for(size_t i = 0; i < mBuffers.size(); ++i) {
+                    fis.seekg(mDataOffset + mOffsets[i], std::ios_base::beg);
+                    mBuffers[i].resize(mSizes[i]);
+                    fis.read(mBuffers[i].data(), mSizes[i]);
+                }
+                if(!fis) {
+                    throw std::runtime_error(strerror(errno));
+                }
             }
         }
 
@@ -180,11 +221,17 @@ namespace gm1
 
         mPath = std::move(path);
         mIsOpened = true;
+        UpdateCache();
     }
 
     void GM1Reader::Close()
     {
         mIsOpened = false;
+        mMapping.reset();
+        mCache.reset();
+        if(mImageCache) {
+            mImageCache->Clear();
+        }
     }
 
     gm1::ArchiveType GM1Reader::ArchiveType() const
@@ -204,34 +251,50 @@ namespace gm1
     
     char const* GM1Reader::EntryData(size_t index) const
     {
-        const ReaderEntryData &entry = mEntries.at(index);
+        const uint32_t offset = mOffsets.at(index);
+        const uint32_t size = mSizes[index];
 
-        if(!entry.buffer.empty() || (entry.size == 0)) {
-            return entry.buffer.data();
+        if(mMapping) {
+            // Bounds are checked in Open
+            return mMapping->data() + mDataOffset + offset;
         }
-        
-        try {
-            boost::filesystem::ifstream fis(mPath, std::ios_base::binary);
-            if(!fis.is_open()) {
-                throw std::runtime_error(strerror(errno));
-            }
-            fis.seekg(entry.offset + mDataOffset);
-            entry.buffer.resize(entry.size);
-            fis.read(entry.buffer.data(), entry.size);
-            if(!fis) {
-                throw std::runtime_error(strerror(errno));
+
+        std::vector<char> &entry = mBuffers.at(index);
+        {
+            std::lock_guard<std::mutex> lock(mBufferMutex);
+            if(!entry.empty() || (size == 0)) {
+                return entry.data();
             }
-        } catch(const std::exception &error) {
-            entry.buffer.clear();
-            throw;
         }
-        
-        return entry.buffer.data();
+
+        // Reading is done without the lock, the first thread to finish wins.
+        // Once filled the buffer is never changed, so the pointer stays valid.
+        std::vector<char> buffer(size);
+        boost::filesystem::ifstream fis(mPath, std::ios_base::binary);
+        if(!fis.is_open()) {
+            throw std::runtime_error(strerror(errno));
+        }
+        fis.seekg(offset + mDataOffset);
+        fis.read(buffer.data(), buffer.size());
+        if(!fis) {
+            throw std::runtime_error(strerror(errno));
+        }
+
+        std::lock_guard<std::mutex> lock(mBufferMutex);
+        if(entry.empty()) {
+            entry.swap(buffer);
+        }
+        return entry.data();
     }
 
     size_t GM1Reader::EntrySize(size_t index) const
     {
-        return mEntries.at(index).size;
+        return mSizes.at(index);
+    }
+
+    size_t GM1Reader::EntryOffset(size_t index) const
+    {
+        return mOffsets.at(index);
     }
 
     gm1::Header const& GM1Reader::Header() const
@@ -241,7 +304,18 @@ namespace gm1
 
     gm1::EntryHeader const& GM1Reader::EntryHeader(size_t index) const
     {
-        return mEntries.at(index).header;
+        return mEntryHeaders.at(index);
+    }
+
+    const std::vector<size_t> GM1Reader::GroupEntries(size_t group) const
+    {
+        std::vector<size_t> indices;
+        for(size_t i = 0; i < mEntryHeaders.size(); ++i) {
+            if(mEntryHeaders[i].group == group) {
+                indices.push_back(i);
+            }
+        }
+        return indices;
     }
 
     core::Palette const& GM1Reader::Palette(size_t index) const
@@ -253,14 +327,237 @@ namespace gm1
     {
         if(mEntryReader) {
             mEntryReader->Transparent(color);
+            if(mImageCache) {
+                mImageCache->Clear();
+            }
+            UpdateCache();
         }
     }
+
+    void GM1Reader::SetCacheDirectory(const boost::filesystem::path &dir)
+    {
+        mCacheDir = dir;
+        UpdateCache();
+    }
+
+    void GM1Reader::SetImageCacheBudget(size_t bytes)
+    {
+        if(bytes == 0) {
+            mImageCache.reset();
+        } else {
+            mImageCache.reset(new ImageCache(bytes));
+        }
+    }
+
+    const ImageCacheStats GM1Reader::ImageCacheStatistics() const
+    {
+        if(!mImageCache) {
+            return ImageCacheStats();
+        }
+        return mImageCache->Stats();
+    }
+
+    void GM1Reader::UpdateCache()
+    {
+        mCache.reset();
+        if(mCacheDir.empty() || !mIsOpened) {
+            return;
+        }
+
+        const core::Color color = mEntryReader->Transparent();
+        const uint32_t transparent = (uint32_t(color.a) << 24) | (uint32_t(color.r) << 16) | (uint32_t(color.g) << 8) | color.b;
+        const DecodeCacheKey key = MakeDecodeCacheKey(mPath, transparent);
+        const boost::filesystem::path file = DecodeCachePath(mCacheDir, key);
+
+        std::unique_ptr<DecodeCache> cache(new DecodeCache);
+        if(!cache->Open(file, key)) {
+            boost::filesystem::create_directories(mCacheDir);
+            DecodeCache::Write(file, key, *this);
+            if(!cache->Open(file, key)) {
+                throw std::runtime_error("Unable to open decode cache");
+            }
+        }
+
+        if(cache->NumEntries() != NumEntries()) {
+            throw std::logic_error("Decode cache doesn't match the collection");
+        }
+        mCache = std::move(cache);
+    }
     
     const core::Image GM1Reader::ReadEntry(size_t index) const
     {
+        core::Image image;
+        if(mImageCache && mImageCache->Lookup(index, image)) {
+            return image;
+        }
+
+        if(mCache) {
+            image = mCache->Load(index);
+            image.SetColorKey(mEntryReader->Transparent());
+        } else {
+            const gm1::EntryHeader &header = EntryHeader(index);
+            const char *data = EntryData(index);
+            const size_t bytesCount = EntrySize(index);
+            image = mEntryReader->Load(header, data, bytesCount);
+        }
+
+        if(mImageCache) {
+            mImageCache->Insert(index, image);
+        }
+        return image;
+    }
+
+    void GM1Reader::PrefetchEntries(const std::vector<size_t> &indices) const
+    {
+        if(mMapping) {
+            return;
+        }
+
+        std::vector<size_t> pending;
+        {
+            std::lock_guard<std::mutex> lock(mBufferMutex);
+            for(size_t index : indices) {
+                if(mBuffers.at(index).empty() && (mSizes[index] != 0)) {
+                    pending.push_back(index);
+                }
+            }
+        }
+
+        if(pending.empty()) {
+            return;
+        }
+
+        std::sort(pending.begin(), pending.end(), [this](size_t lhs, size_t rhs) {
+                return (mOffsets[lhs] != mOffsets[rhs])
+                    ? (mOffsets[lhs] < mOffsets[rhs])
+                    : (lhs < rhs);
+            });
+        pending.erase(std::unique(pending.begin(), pending.end()), pending.end());
+
+        boost::filesystem::ifstream fis(mPath, std::ios_base::binary);
+        if(!fis.is_open()) {
+            throw std::runtime_error(strerror(errno));
+        }
+
+        std::vector<char> block;
+        for(size_t first = 0; first < pending.size(); ) {
+            const size_t begin = mOffsets[pending[first]];
+            size_t end = begin + mSizes[pending[first]];
+            size_t last = first + 1;
+            while(last < pending.size()) {
+                const size_t offset = mOffsets[pending[last]];
+                const size_t size = mSizes[pending[last]];
+                if((offset > end + MaxReadGap) || (offset + size - begin > MaxReadSize)) {
+                    break;
+                }
+                end = std::max(end, offset + size);
+                ++last;
+            }
+
+            block.resize(end - begin);
+            fis.seekg(mDataOffset + begin);
+            fis.read(block.data(), block.size());
+            if(!fis) {
+                throw std::runtime_error(strerror(errno));
+            }
+
+            for(size_t i = first; i < last; ++i) {
+                const size_t index = pending[i];
+                const char *data = block.data() + (mOffsets[index] - begin);
+                std::vector<char> buffer(data, data + mSizes[index]);
+
+                std::lock_guard<std::mutex> lock(mBufferMutex);
+                if(mBuffers[index].empty()) {
+                    mBuffers[index].swap(buffer);
+                }
+            }
+            first = last;
+        }
+    }
+
+    const std::vector<core::Image> GM1Reader::ReadEntries(const std::vector<size_t> &indices, size_t numThreads) const
+    {
+        if(!mCache) {
+            PrefetchEntries(indices);
+        }
+
+        std::vector<core::Image> images(indices.size());
+        core::ParallelFor(indices.size(), numThreads, [this, &indices, &images](size_t i) {
+                images[i] = ReadEntry(indices[i]);
+            });
+        return images;
+    }
+
+    const std::vector<core::Image> GM1Reader::ReadEntries(size_t first, size_t count, size_t numThreads) const
+    {
+        if((first > NumEntries()) || (count > NumEntries() - first)) {
+            throw std::out_of_range("Entry range is out of range");
+        }
+
+        std::vector<size_t> indices(count);
+        for(size_t i = 0; i < count; ++i) {
+            indices[i] = first + i;
+        }
+        return ReadEntries(indices, numThreads);
+    }
+
+    const core::RleSprite GM1Reader::ReadEntrySprite(size_t index) const
+    {
+        uint32_t format = tgx::PixelFormat;
+        switch(ArchiveType()) {
+        case gm1::ArchiveType::TGX8:
+            format = SDL_PIXELFORMAT_INDEX8;
+            break;
+        case gm1::ArchiveType::TGX16:
+        case gm1::ArchiveType::Font:
+            break;
+        default:
+            throw std::logic_error("Only tgx entries can be read as sprites");
+        }
+
         const gm1::EntryHeader &header = EntryHeader(index);
-        const char *data = EntryData(index);
-        const size_t bytesCount = EntrySize(index);
-        return mEntryReader->Load(header, data, bytesCount);
+        return tgx::DecodeSprite(EntryData(index), EntrySize(index), header.width, header.height, format);
+    }
+
+    const PaletteVariants GM1Reader::ReadEntryVariants(size_t index, const std::vector<size_t> &palettes, uint32_t format) const
+    {
+        if(ArchiveType() != gm1::ArchiveType::TGX8) {
+            throw std::logic_error("Only 8-bit entries have palette variants");
+        }
+
+        std::vector<size_t> selected = palettes;
+        if(selected.empty()) {
+            for(size_t i = 0; i < NumPalettes(); ++i) {
+                selected.push_back(i);
+            }
+        }
+
+        PaletteVariants variants;
+        variants.indices = ReadEntry(index);
+        variants.images.reserve(selected.size());
+
+        core::Image &indices = variants.indices;
+        core::ImageLocker lock(indices);
+        
+        for(size_t paletteIndex : selected) {
+            // Palette is deep copied since SDL_Palette refcount isn't thread-safe
+            // and variants are likely to be passed to other threads.
+            const core::Palette &source = Palette(paletteIndex);
+            core::Palette palette(source.Size());
+            std::copy(source.begin(), source.end(), palette.begin());
+
+            core::Image view = core::CreateImageFrom(lock.Data(), indices.Width(), indices.Height(), indices.RowStride(), core::ImageFormat(indices));
+            view.AttachPalette(palette);
+
+            core::Image variant = (format == SDL_PIXELFORMAT_INDEX8)
+                ? view
+                : core::ConvertImage(view, format);
+            if(indices.ColorKeyEnabled()) {
+                variant.SetColorKey(indices.GetColorKey());
+            }
+            variants.images.push_back(variant);
+        }
+        
+        return variants;
     }
 }
@@ -4,26 +4,49 @@
 #include <cstddef>
 #include <cstdint>
 #include <memory>
+#include <mutex>
+#include <vector>
 
 #include <boost/filesystem/path.hpp>
 
+#include <core/image.h>
+
 #include <gm1/gm1.h>
+#include <gm1/gm1imagecache.h>
 
 namespace core
 {
     class Color;
     class Image;
     class Palette;
+    class RleSprite;
 }
 
 namespace gm1
 {
+    class DecodeCache;
     class GM1EntryReader;
 }
 
+namespace boost
+{
+    namespace iostreams
+    {
+        class mapped_file_source;
+    }
+}
+
 namespace gm1
 {
-    class ReaderEntryData;
+    /**
+     * \brief The same 8-bit entry drawn with several palettes.
+     */
+    struct PaletteVariants
+    {
+        // Decoded entry; indexed variants share its pixels.
+        core::Image indices;
+        std::vector<core::Image> images;
+    };
 
     class GM1Reader
     {
@@ -32,15 +55,29 @@ namespace gm1
         std::streamoff mDataOffset;
         gm1::Header mHeader;
         std::vector<core::Palette> mPalettes;
-        std::vector<ReaderEntryData> mEntries;
+        // Entry tables are kept apart, so scans over headers stay dense
+        std::vector<uint32_t> mOffsets;
+        std::vector<uint32_t> mSizes;
+        std::vector<gm1::EntryHeader> mEntryHeaders;
+        // Lazily read entry data, left empty for mapped files
+        mutable std::vector<std::vector<char>> mBuffers;
         std::unique_ptr<GM1EntryReader> mEntryReader;
+        std::unique_ptr<boost::iostreams::mapped_file_source> mMapping;
+        boost::filesystem::path mCacheDir;
+        std::unique_ptr<DecodeCache> mCache;
+        std::unique_ptr<ImageCache> mImageCache;
+        mutable std::mutex mBufferMutex;
+
+        void UpdateCache();
+        void PrefetchEntries(const std::vector<size_t> &indices) const;
         
     public:
         enum Flags
         {
             NoFlags = 0,
             Cached = 1,
-            CheckSizeCategory = 2
+            CheckSizeCategory = 2,
+            Mapped = 4
         };
 
         explicit GM1Reader(const boost::filesystem::wpath& = boost::filesystem::wpath(), Flags = NoFlags);
@@ -51,11 +88,77 @@ namespace gm1
         void Close();
 
         void SetTransparentColor(const core::Color &color);
+
+        /**
+         * \brief Keeps decoded entries in the directory between runs.
+         *
+         * Cache file is created on first use and rebuilt whenever
+         * the collection or transparent color changes. ReadEntry takes
+         * images from the cache then. Empty path disables caching.
+         */
+        void SetCacheDirectory(const boost::filesystem::path &dir);
+
+        /**
+         * \brief Keeps recently decoded entries in memory.
+         *
+         * ReadEntry returns copies of cached images, so the reader
+         * may be shared between threads. Zero budget disables caching.
+         *
+         * \param bytes  Upper bound of cached pixel data.
+         */
+        void SetImageCacheBudget(size_t bytes);
+        const ImageCacheStats ImageCacheStatistics() const;
         
         const char* EntryData(size_t index) const;
         size_t EntrySize(size_t index) const;
+
+        /**
+         * \brief Offset of entry data from the end of the preamble.
+         */
+        size_t EntryOffset(size_t index) const;
         const core::Image ReadEntry(size_t index) const;
+
+        /**
+         * \brief Decodes several entries at once.
+         *
+         * Data of entries which are not in memory yet is read in
+         * few large sequential reads: neighbouring entries are merged
+         * into a single read. Images are returned in order of indices.
+         *
+         * \param numThreads  Number of threads to decode entries on.
+         */
+        const std::vector<core::Image> ReadEntries(const std::vector<size_t> &indices, size_t numThreads = 1) const;
+        const std::vector<core::Image> ReadEntries(size_t first, size_t count, size_t numThreads = 1) const;
+
+        /**
+         * \brief Decodes 8-bit entry once and applies each of palettes to it.
+         *
+         * \param palettes  Palette indices, all palettes are taken if empty.
+         * \param format    Pixel format of variants. Indexed variants are views
+         *                  into `indices' image of the result, others are
+         *                  expanded copies.
+         */
+        const PaletteVariants ReadEntryVariants(size_t index,
+                                                const std::vector<size_t> &palettes = std::vector<size_t>(),
+                                                uint32_t format = SDL_PIXELFORMAT_INDEX8) const;
+
+        /**
+         * \brief Decodes tgx entry into opaque spans only.
+         *
+         * Sprite has 16-bit pixels or palette indices for 8-bit entries.
+         *
+         * \throw std::logic_error if entries are not tgx-encoded.
+         */
+        const core::RleSprite ReadEntrySprite(size_t index) const;
+
         const gm1::EntryHeader& EntryHeader(size_t index) const;
+
+        /**
+         * \brief Indices of entries having `group' field equal to the given one.
+         *
+         * Pass the result into ReadEntries to load the whole group at once.
+         */
+        const std::vector<size_t> GroupEntries(size_t group) const;
         const core::Palette& Palette(size_t index) const;
         const gm1::Header& Header() const;
         gm1::ArchiveType ArchiveType() const;
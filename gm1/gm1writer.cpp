@@ -1,10 +1,14 @@
 #include "gm1writer.h"
 
+#include <algorithm>
 #include <iostream>
+#include <stdexcept>
+#include <vector>
 
 #include <core/iohelpers.h>
 #include <core/color.h>
 #include <core/palette.h>
+#include <core/pixelconvert.h>
 
 #include <gm1/gm1.h>
 
@@ -39,11 +43,79 @@ namespace gm1
 
     std::ostream& WritePalette(std::ostream &out, const core::Palette &palette)
     {
-        for(const core::Palette::value_type &entry : palette) {
-            const core::Color color(entry);
-            const palette_entry_t pixel = color.ConvertTo(PalettePixelFormat);
+        std::vector<uint32_t> colors(palette.Size());
+        std::transform(palette.begin(), palette.end(), colors.begin(), [](const core::Palette::value_type &entry) {
+                return (uint32_t(entry.a) << 24) | (uint32_t(entry.r) << 16) | (uint32_t(entry.g) << 8) | uint32_t(entry.b);
+            });
+
+        std::vector<palette_entry_t> pixels(colors.size());
+        core::ConvertARGB8888ToRGB555(colors.data(), pixels.data(), colors.size());
+        for(const palette_entry_t pixel : pixels) {
             core::WriteLittle(out, pixel);
         }
         return out;
     }
+
+    std::ostream& WriteEntryHeader(std::ostream &out, const gm1::EntryHeader &header)
+    {
+        core::WriteLittle(out, header.width);
+        core::WriteLittle(out, header.height);
+        core::WriteLittle(out, header.posX);
+        core::WriteLittle(out, header.posY);
+        core::WriteLittle(out, header.group);
+        core::WriteLittle(out, header.groupSize);
+        core::WriteLittle(out, header.tileY);
+        core::WriteLittle(out, header.tileOrient);
+        core::WriteLittle(out, header.hOffset);
+        core::WriteLittle(out, header.boxWidth);
+        core::WriteLittle(out, header.flags);
+        return out;
+    }
+
+    std::ostream& WriteCollection(std::ostream &out,
+                                  const gm1::Header &header,
+                                  const std::vector<core::Palette> &palettes,
+                                  const std::vector<gm1::EntryHeader> &headers,
+                                  const std::vector<std::string> &entries)
+    {
+        if(palettes.size() != CollectionPaletteCount) {
+            throw std::logic_error("Collection should have exactly 10 palettes");
+        }
+        
+        if(headers.size() != entries.size()) {
+            throw std::logic_error("Number of entry headers doesn't match number of entries");
+        }
+
+        gm1::Header fixed = header;
+        fixed.imageCount = entries.size();
+        fixed.dataSize = 0;
+        for(const std::string &entry : entries) {
+            fixed.dataSize += entry.size();
+        }
+
+        WriteHeader(out, fixed);
+        for(const core::Palette &palette : palettes) {
+            WritePalette(out, palette);
+        }
+
+        uint32_t offset = 0;
+        for(const std::string &entry : entries) {
+            core::WriteLittle(out, offset);
+            offset += entry.size();
+        }
+
+        for(const std::string &entry : entries) {
+            core::WriteLittle<uint32_t>(out, entry.size());
+        }
+
+        for(const gm1::EntryHeader &entryHeader : headers) {
+            WriteEntryHeader(out, entryHeader);
+        }
+
+        for(const std::string &entry : entries) {
+            out.write(entry.data(), entry.size());
+        }
+        
+        return out;
+    }
 }
@@ -2,6 +2,8 @@
 #define gm1WRITER_H_
 
 #include <iosfwd>
+#include <string>
+#include <vector>
 
 namespace core
 {
@@ -11,12 +13,28 @@ namespace core
 namespace gm1
 {
     class Header;
+    class EntryHeader;
 }
 
 namespace gm1
 {
     std::ostream& WriteHeader(std::ostream&, gm1::Header const&);
     std::ostream& WritePalette(std::ostream&, const core::Palette &palette);
+    std::ostream& WriteEntryHeader(std::ostream&, gm1::EntryHeader const&);
+
+    /**
+     * \brief Writes the whole collection.
+     *
+     * `imageCount' and `dataSize' fields of the header as well as
+     * offset and size tables are evaluated from entries.
+     *
+     * \param entries       Encoded entry data in index order.
+     */
+    std::ostream& WriteCollection(std::ostream &out,
+                                  gm1::Header const& header,
+                                  const std::vector<core::Palette> &palettes,
+                                  const std::vector<gm1::EntryHeader> &headers,
+                                  const std::vector<std::string> &entries);
 }
 
 #endif // gm1WRITER_H_
@@ -0,0 +1,106 @@
+#include "atlasmode.h"
+
+#include <cerrno>
+#include <cstring>
+
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+#include <boost/filesystem/fstream.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <boost/program_options/options_description.hpp>
+#include <boost/program_options/positional_options.hpp>
+
+#include <gmtool/renderer.h>
+
+#include <gm1/gm1.h>
+#include <gm1/gm1atlas.h>
+#include <gm1/gm1reader.h>
+
+#include <core/image.h>
+
+namespace po = boost::program_options;
+
+namespace gmtool
+{
+    AtlasMode::~AtlasMode() throw() = default;
+    AtlasMode::AtlasMode()
+    {
+        mFormats = RenderFormats();
+    }
+
+    void AtlasMode::GetOptions(po::options_description &opts)
+    {
+        po::options_description mode("Atlas mode");
+        mode.add_options()
+            ("output,o",          po::value(&mOutputDir)->required(),                                    "Set output directory")
+            ("file",              po::value(&mInputFiles)->required(),                                   "Add GM1 filename")
+            ("format,f",          po::value(&mFormat)->default_value(mFormats.front().name),             "Set page file format")
+            ("palette,p",         po::value(&mPaletteIndex),                                             "Set palette index for 8-bit entries")
+            ("page-width",        po::value(&mPageWidth)->default_value(mPageWidth),                     "Set page width")
+            ("page-height",       po::value(&mPageHeight)->default_value(mPageHeight),                   "Set page height")
+            ("padding",           po::value(&mPadding)->default_value(mPadding),                         "Set space between entries")
+            ;
+        opts.add(mode);
+    }
+
+    void AtlasMode::GetPositionalOptions(po::positional_options_description &unnamed)
+    {
+        unnamed.add("output", 1);
+        unnamed.add("file", -1);
+    }
+
+    void AtlasMode::PrintUsage(std::ostream &out)
+    {
+        out << "Usage: gmtool atlas <output dir> <file.gm1>..." << std::endl;
+        out << "Allowed page formats are:" << std::endl;
+        PrintRenderFormats(out, mFormats);
+    }
+
+    const boost::filesystem::path AtlasMode::PagePath(size_t page, const std::string &format) const
+    {
+        std::ostringstream oss;
+        oss << "page" << std::setw(3) << std::setfill('0') << page << '.' << format;
+        return mOutputDir / oss.str();
+    }
+
+    int AtlasMode::Exec(const ModeConfig &cfg)
+    {
+        cfg.verbose << "Find appropriate format" << std::endl;
+        const RenderFormat &result = FindRenderFormat(mFormats, mFormat);
+
+        gm1::AtlasBuilder builder(mPageWidth, mPageHeight, SDL_PIXELFORMAT_ARGB8888, mPadding);
+        for(const boost::filesystem::path &path : mInputFiles) {
+            cfg.verbose << "Reading file " << path << std::endl;
+            gm1::GM1Reader reader(path, gm1::GM1Reader::Mapped);
+            reader.SetCacheDirectory(cfg.cacheDir);
+            const size_t collection = builder.AddCollection(reader, mPaletteIndex);
+            cfg.verbose << "Collection " << collection << " contains " << reader.NumEntries() << " entries" << std::endl;
+        }
+
+        const gm1::Atlas atlas = builder.Build();
+        cfg.verbose << atlas.entries.size() << " entries packed into " << atlas.pages.size() << " pages" << std::endl;
+
+        if(!boost::filesystem::exists(mOutputDir)) {
+            cfg.verbose << "Create directory " << mOutputDir << std::endl;
+            boost::filesystem::create_directories(mOutputDir);
+        }
+
+        for(size_t page = 0; page < atlas.pages.size(); ++page) {
+            boost::filesystem::ofstream fout(PagePath(page, result.name), std::ios_base::binary | std::ios_base::out);
+            if(!fout) {
+                throw std::runtime_error(strerror(errno));
+            }
+            result.renderer->RenderToStream(fout, atlas.pages[page]);
+        }
+
+        boost::filesystem::ofstream fout(mOutputDir / "atlas.txt", std::ios_base::out);
+        if(!fout) {
+            throw std::runtime_error(strerror(errno));
+        }
+        gm1::WriteAtlasIndex(fout, atlas);
+
+        return EXIT_SUCCESS;
+    }
+}
@@ -0,0 +1,49 @@
+#ifndef ATLASMODE_H_
+#define ATLASMODE_H_
+
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem/path.hpp>
+
+#include <gmtool/mode.h>
+
+namespace gmtool
+{
+    class RenderFormat;
+}
+
+namespace gmtool
+{
+    /**
+     * \brief Packs entries of collections into texture pages.
+     *
+     * Writes page images along with `atlas.txt' index which maps
+     * collection entries onto page rects.
+     */
+    class AtlasMode : public Mode
+    {
+        std::vector<boost::filesystem::path> mInputFiles;
+        boost::filesystem::path mOutputDir;
+        std::string mFormat;
+        size_t mPaletteIndex = 0;
+        int mPageWidth = 2048;
+        int mPageHeight = 2048;
+        int mPadding = 1;
+        std::vector<RenderFormat> mFormats;
+
+        const boost::filesystem::path PagePath(size_t page, const std::string &format) const;
+
+    public:
+        AtlasMode();
+        virtual ~AtlasMode() throw();
+
+        void PrintUsage(std::ostream &out);
+        void GetOptions(boost::program_options::options_description&);
+        void GetPositionalOptions(boost::program_options::positional_options_description&);
+        int Exec(const ModeConfig &config);
+    };
+}
+
+#endif // ATLASMODE_H_
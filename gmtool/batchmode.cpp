@@ -0,0 +1,357 @@
+#include "batchmode.h"
+
+#include <cerrno>
+#include <cstring>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#include <boost/filesystem/fstream.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <boost/program_options/options_description.hpp>
+#include <boost/program_options/positional_options.hpp>
+
+#include <gmtool/collectionfiles.h>
+#include <gmtool/renderer.h>
+
+#include <gm1/gm1.h>
+#include <gm1/gm1reader.h>
+
+#include <core/image.h>
+#include <core/palette.h>
+#include <core/parallel.h>
+#include <core/taskpool.h>
+
+namespace po = boost::program_options;
+
+namespace
+{
+    typedef std::chrono::steady_clock Clock;
+
+    struct Archive
+    {
+        boost::filesystem::path path;
+        boost::filesystem::path outputDir;
+        std::unique_ptr<gm1::GM1Reader> reader;
+        gm1::ArchiveType type = gm1::ArchiveType::Unknown;
+        uint64_t fileSize = 0;
+        size_t numEntries = 0;
+        std::atomic<size_t> remaining {0};
+        std::atomic<uint64_t> pixels {0};
+        std::atomic<uint64_t> busy {0};
+    };
+
+    struct Progress
+    {
+        std::atomic<size_t> archivesDone {0};
+        std::atomic<size_t> entriesDone {0};
+        std::atomic<size_t> entriesTotal {0};
+    };
+
+    struct TypeSummary
+    {
+        size_t archives = 0;
+        size_t entries = 0;
+        uint64_t bytes = 0;
+        uint64_t pixels = 0;
+        double seconds = 0;
+    };
+
+    uint64_t ElapsedNanoseconds(const Clock::time_point &start)
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+    }
+
+    void PrintProgress(std::ostream &out, const Progress &progress, size_t numArchives)
+    {
+        out << "\rArchives " << progress.archivesDone << '/' << numArchives
+            << ", entries " << progress.entriesDone << '/' << progress.entriesTotal
+            << std::flush;
+    }
+
+    void PrintSummary(std::ostream &out, const std::map<gm1::ArchiveType, TypeSummary> &summary)
+    {
+        out << std::left << std::setw(12) << "Type"
+            << std::right
+            << std::setw(10) << "Archives"
+            << std::setw(10) << "Entries"
+            << std::setw(12) << "Input MiB"
+            << std::setw(12) << "Pixels M"
+            << std::setw(10) << "Time s"
+            << std::setw(12) << "Entries/s"
+            << std::setw(10) << "MiB/s"
+            << std::endl;
+
+        out << std::fixed;
+        for(const auto &item : summary) {
+            const TypeSummary &type = item.second;
+            const double mib = type.bytes / (1024.0 * 1024.0);
+            const double seconds = std::max(type.seconds, 1e-9);
+            out << std::left << std::setw(12) << gm1::GetArchiveTypeName(item.first)
+                << std::right
+                << std::setw(10) << type.archives
+                << std::setw(10) << type.entries
+                << std::setw(12) << std::setprecision(2) << mib
+                << std::setw(12) << std::setprecision(2) << type.pixels / 1e6
+                << std::setw(10) << std::setprecision(3) << type.seconds
+                << std::setw(12) << std::setprecision(0) << type.entries / seconds
+                << std::setw(10) << std::setprecision(2) << mib / seconds
+                << std::endl;
+        }
+        out.unsetf(std::ios_base::floatfield);
+    }
+}
+
+namespace gmtool
+{
+    BatchMode::~BatchMode() throw() = default;
+    BatchMode::BatchMode()
+    {
+        mFormats = RenderFormats();
+    }
+
+    void BatchMode::GetOptions(po::options_description &opts)
+    {
+        po::options_description mode("Batch mode");
+        mode.add_options()
+            ("command",           po::value(&mCommand)->required(),                                      "Set command: unpack or decode")
+            ("files",             po::value(&mInputFiles),                                               "Set GM1 filenames or directories")
+            ("manifest",          po::value(&mManifestFile),                                             "Read GM1 filenames from the file, one per line")
+            ("output,o",          po::value(&mOutputDir),                                                "Set output directory for unpack")
+            ("format,f",          po::value(&mFormat)->default_value(mFormats.front().name),             "Set entry file format")
+            ("compression",       po::value(&mCompressionLevel)->default_value(mCompressionLevel),       "Set compression level 0..9, -1 for format default")
+            ("palette,p",         po::value(&mPaletteIndex),                                             "Set palette index for 8-bit entries")
+            ("jobs,j",            po::value(&mNumJobs)->default_value(core::HardwareConcurrency()),      "Set number of threads")
+            ("chunk",             po::value(&mChunkSize)->default_value(mChunkSize),                     "Set number of entries per task")
+            ("progress",          po::bool_switch(&mProgress),                                           "Report progress to stderr")
+            ;
+        opts.add(mode);
+    }
+
+    void BatchMode::GetPositionalOptions(po::positional_options_description &unnamed)
+    {
+        unnamed.add("command", 1);
+        unnamed.add("files", -1);
+    }
+
+    void BatchMode::PrintUsage(std::ostream &out)
+    {
+        out << "Usage: gmtool batch <command> <files or directories...>" << std::endl;
+        out << "Allowed commands are:" << std::endl;
+        out << "   unpack  Unpack every collection into <output>/<name>" << std::endl;
+        out << "   decode  Decode entries without writing them" << std::endl;
+        out << "Allowed entry formats are:" << std::endl;
+        PrintRenderFormats(out, mFormats);
+    }
+
+    int BatchMode::Exec(const ModeConfig &cfg)
+    {
+        const bool unpack = (mCommand == "unpack");
+        if(!unpack && mCommand != "decode") {
+            throw std::logic_error("Command should be either unpack or decode");
+        }
+
+        if(unpack && mOutputDir.empty()) {
+            throw std::logic_error("You should specify --output option");
+        }
+
+        if(mNumJobs == 0) {
+            throw std::logic_error("Number of jobs should be positive");
+        }
+
+        if(mChunkSize == 0) {
+            throw std::logic_error("Chunk size should be positive");
+        }
+
+        cfg.verbose << "Find appropriate format" << std::endl;
+        const RenderFormat &result = FindRenderFormat(mFormats, mFormat);
+        result.renderer->SetCompressionLevel(mCompressionLevel);
+
+        const std::vector<boost::filesystem::path> files = FindCollectionFiles(mInputFiles, mManifestFile);
+        if(files.empty()) {
+            throw std::logic_error("No collections to process");
+        }
+
+        // Stems name output directories, so the same stem would mix entries
+        std::vector<std::unique_ptr<Archive>> archives;
+        std::map<boost::filesystem::path, size_t> stems;
+        for(const boost::filesystem::path &path : files) {
+            std::unique_ptr<Archive> archive(new Archive);
+            archive->path = path;
+            archive->fileSize = boost::filesystem::file_size(path);
+            if(unpack) {
+                const boost::filesystem::path stem = path.stem();
+                const size_t count = stems[stem]++;
+                if(count == 0) {
+                    archive->outputDir = mOutputDir / stem;
+                } else {
+                    archive->outputDir = mOutputDir / (stem.string() + "." + std::to_string(count));
+                }
+            }
+            archives.push_back(std::move(archive));
+        }
+
+        cfg.verbose << "Processing " << archives.size() << " collections using " << mNumJobs << " jobs" << std::endl;
+
+        core::TaskPool pool(mNumJobs);
+        Progress progress;
+
+        auto processChunk = [&, unpack](Archive &archive, size_t first, size_t last) {
+            const Clock::time_point start = Clock::now();
+            const core::Palette &palette = archive.reader->Palette(mPaletteIndex);
+
+            uint64_t pixels = 0;
+            for(size_t index = first; index < last; ++index) {
+                core::Image entry = archive.reader->ReadEntry(index);
+                pixels += entry.Width() * entry.Height();
+
+                if(!unpack) {
+                    continue;
+                }
+
+                PrepareEntryForRender(entry, palette);
+
+                std::ostringstream name;
+                name << std::setw(5) << std::setfill('0') << index << '.' << result.name;
+
+                boost::filesystem::ofstream fout(archive.outputDir / name.str(), std::ios_base::binary | std::ios_base::out);
+                if(!fout) {
+                    throw std::runtime_error(strerror(errno));
+                }
+                result.renderer->RenderToStream(fout, entry);
+            }
+
+            archive.pixels += pixels;
+            archive.busy += ElapsedNanoseconds(start);
+            progress.entriesDone += last - first;
+
+            if(--archive.remaining == 0) {
+                archive.reader.reset();
+                ++progress.archivesDone;
+            }
+        };
+
+        auto openArchive = [&, unpack](Archive &archive) {
+            const Clock::time_point start = Clock::now();
+            try {
+                archive.reader.reset(new gm1::GM1Reader(archive.path, gm1::GM1Reader::Mapped));
+                if(!cfg.cacheDir.empty()) {
+                    archive.reader->SetCacheDirectory(cfg.cacheDir);
+                }
+            } catch(const std::exception &error) {
+                throw std::runtime_error(archive.path.string() + ": " + error.what());
+            }
+
+            archive.type = archive.reader->ArchiveType();
+            archive.numEntries = archive.reader->NumEntries();
+            progress.entriesTotal += archive.numEntries;
+
+            if(mPaletteIndex >= archive.reader->NumPalettes()) {
+                throw std::logic_error("Palette index is out of range");
+            }
+
+            if(unpack && !boost::filesystem::exists(archive.outputDir)) {
+                boost::filesystem::create_directories(archive.outputDir);
+            }
+
+            archive.busy += ElapsedNanoseconds(start);
+
+            // Chunks are spawned in reverse, so that the owning thread
+            // goes from the first entry while thieves take the last ones.
+            const size_t numChunks = (archive.numEntries + mChunkSize - 1) / mChunkSize;
+            if(numChunks == 0) {
+                archive.reader.reset();
+                ++progress.archivesDone;
+                return;
+            }
+
+            archive.remaining = numChunks;
+            for(size_t chunk = numChunks; chunk-- > 0; ) {
+                const size_t first = chunk * mChunkSize;
+                const size_t last = std::min(first + mChunkSize, archive.numEntries);
+                pool.Spawn([&processChunk, &archive, first, last]() {
+                        processChunk(archive, first, last);
+                    });
+            }
+        };
+
+        // Larger files go first, so they are split before small ones run out
+        std::vector<Archive*> order;
+        for(const std::unique_ptr<Archive> &archive : archives) {
+            order.push_back(archive.get());
+        }
+        std::stable_sort(order.begin(), order.end(), [](const Archive *lhs, const Archive *rhs) {
+                return lhs->fileSize > rhs->fileSize;
+            });
+
+        for(Archive *archive : order) {
+            pool.Spawn([&openArchive, archive]() {
+                    openArchive(*archive);
+                });
+        }
+
+        std::mutex reporterMutex;
+        std::condition_variable reporterWakeUp;
+        bool finished = false;
+        std::thread reporter;
+        if(mProgress) {
+            reporter = std::thread([&]() {
+                    std::unique_lock<std::mutex> lock(reporterMutex);
+                    while(!reporterWakeUp.wait_for(lock, std::chrono::milliseconds(500), [&finished]() { return finished; })) {
+                        PrintProgress(std::clog, progress, archives.size());
+                    }
+                });
+        }
+
+        auto stopReporter = [&]() {
+            if(reporter.joinable()) {
+                {
+                    std::lock_guard<std::mutex> lock(reporterMutex);
+                    finished = true;
+                }
+                reporterWakeUp.notify_one();
+                reporter.join();
+                PrintProgress(std::clog, progress, archives.size());
+                std::clog << std::endl;
+            }
+        };
+
+        const Clock::time_point start = Clock::now();
+        try {
+            pool.Run();
+        } catch(...) {
+            stopReporter();
+            throw;
+        }
+        const double seconds = ElapsedNanoseconds(start) / 1e9;
+        stopReporter();
+
+        std::map<gm1::ArchiveType, TypeSummary> summary;
+        for(const std::unique_ptr<Archive> &archive : archives) {
+            TypeSummary &type = summary[archive->type];
+            type.archives += 1;
+            type.entries += archive->numEntries;
+            type.bytes += archive->fileSize;
+            type.pixels += archive->pixels;
+            type.seconds += archive->busy / 1e9;
+        }
+
+        PrintSummary(cfg.stdout, summary);
+        cfg.stdout << progress.entriesDone << " entries of " << archives.size() << " collections in "
+                   << std::fixed << std::setprecision(3) << seconds << " s using "
+                   << pool.NumThreads() << " threads, " << pool.NumSteals() << " tasks stolen" << std::endl;
+        cfg.stdout.unsetf(std::ios_base::floatfield);
+
+        return EXIT_SUCCESS;
+    }
+}
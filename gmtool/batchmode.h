@@ -0,0 +1,51 @@
+#ifndef BATCHMODE_H_
+#define BATCHMODE_H_
+
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem/path.hpp>
+
+#include <gmtool/mode.h>
+
+namespace gmtool
+{
+    class RenderFormat;
+}
+
+namespace gmtool
+{
+    /**
+     * \brief Processes many collections at once.
+     *
+     * Collections are opened by tasks of a work-stealing pool and split
+     * into chunks of entries, so large collections spread over threads
+     * which are done with small ones. Throughput is summarized per archive type.
+     */
+    class BatchMode : public Mode
+    {
+        std::string mCommand;
+        std::vector<boost::filesystem::path> mInputFiles;
+        boost::filesystem::path mManifestFile;
+        boost::filesystem::path mOutputDir;
+        std::string mFormat;
+        size_t mPaletteIndex = 0;
+        int mCompressionLevel = -1;
+        size_t mNumJobs = 1;
+        size_t mChunkSize = 16;
+        bool mProgress = false;
+        std::vector<RenderFormat> mFormats;
+
+    public:
+        BatchMode();
+        virtual ~BatchMode() throw();
+
+        void PrintUsage(std::ostream &out);
+        void GetOptions(boost::program_options::options_description&);
+        void GetPositionalOptions(boost::program_options::positional_options_description&);
+        int Exec(const ModeConfig &config);
+    };
+}
+
+#endif // BATCHMODE_H_
@@ -0,0 +1,67 @@
+#include "collectionfiles.h"
+
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+#include <boost/filesystem/fstream.hpp>
+#include <boost/filesystem/operations.hpp>
+
+namespace
+{
+    bool IsCollectionFile(const boost::filesystem::path &path)
+    {
+        std::string ext = path.extension().string();
+        std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+        return ext == ".gm1";
+    }
+}
+
+namespace gmtool
+{
+    const std::vector<boost::filesystem::path> FindCollectionFiles(const std::vector<boost::filesystem::path> &paths,
+                                                                   const boost::filesystem::path &manifest)
+    {
+        std::vector<boost::filesystem::path> listed = paths;
+
+        if(!manifest.empty()) {
+            boost::filesystem::ifstream fin(manifest);
+            if(!fin) {
+                throw std::runtime_error(strerror(errno));
+            }
+
+            std::string line;
+            while(std::getline(fin, line)) {
+                line.erase(0, line.find_first_not_of(" \t\r"));
+                line.erase(line.find_last_not_of(" \t\r") + 1);
+                if(!line.empty() && line[0] != '#') {
+                    listed.push_back(line);
+                }
+            }
+        }
+
+        std::vector<boost::filesystem::path> files;
+        for(const boost::filesystem::path &path : listed) {
+            if(boost::filesystem::is_directory(path)) {
+                // Directory order is unspecified, sort it to get the same output every run
+                std::vector<boost::filesystem::path> found;
+                boost::filesystem::recursive_directory_iterator it(path), end;
+                for(; it != end; ++it) {
+                    if(boost::filesystem::is_regular_file(it->path()) && IsCollectionFile(it->path())) {
+                        found.push_back(it->path());
+                    }
+                }
+                std::sort(found.begin(), found.end());
+                files.insert(files.end(), found.begin(), found.end());
+            } else {
+                files.push_back(path);
+            }
+        }
+
+        return files;
+    }
+}
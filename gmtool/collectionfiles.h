@@ -0,0 +1,21 @@
+#ifndef COLLECTIONFILES_H_
+#define COLLECTIONFILES_H_
+
+#include <vector>
+
+#include <boost/filesystem/path.hpp>
+
+namespace gmtool
+{
+    /**
+     * \brief Lists collections to be processed by multi-file modes.
+     *
+     * Directories are searched recursively for *.gm1 files, other paths
+     * are taken as is. Manifest, if given, lists one path per line;
+     * blank lines and lines starting with '#' are skipped.
+     */
+    const std::vector<boost::filesystem::path> FindCollectionFiles(const std::vector<boost::filesystem::path> &paths,
+                                                                   const boost::filesystem::path &manifest = boost::filesystem::path());
+}
+
+#endif // COLLECTIONFILES_H_
@@ -0,0 +1,466 @@
+#include "exportmode.h"
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem/fstream.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <boost/program_options/options_description.hpp>
+#include <boost/program_options/positional_options.hpp>
+
+#include <gmtool/collectionfiles.h>
+
+#include <gm1/gm1.h>
+#include <gm1/gm1reader.h>
+
+#include <core/endianness.h>
+#include <core/palette.h>
+#include <core/parallel.h>
+
+namespace po = boost::program_options;
+
+namespace
+{
+    const char ColumnsMagic[8] = {'G', 'M', '1', 'C', 'O', 'L', 'S', '\0'};
+    const uint32_t ColumnsVersion = 1;
+
+    /**
+     * Type codes of the columnar format. Integers are little-endian,
+     * strings are stored as 32-bit length followed by bytes.
+     */
+    enum class ColumnType : uint8_t
+    {
+        UInt8 = 1,
+        UInt16 = 2,
+        Int16 = 3,
+        UInt32 = 4,
+        UInt64 = 5,
+        String = 6
+    };
+
+    struct ArchiveRow
+    {
+        uint32_t id;
+        std::string path;
+        std::string type;
+        uint64_t fileSize;
+        gm1::Header header;
+        uint64_t paletteHashes[gm1::CollectionPaletteCount];
+    };
+
+    struct EntryRow
+    {
+        uint32_t archive;
+        uint32_t index;
+        uint32_t offset;
+        uint32_t size;
+        gm1::EntryHeader header;
+    };
+
+    /**
+     * Both formats are driven by the same column list. Integer values are
+     * widened to 64 bits, signed ones are sign-extended.
+     */
+    template<class Row>
+    struct Column
+    {
+        typedef uint64_t (*ValueFunc)(const Row&);
+        typedef const std::string& (*TextFunc)(const Row&);
+
+        const char *name;
+        ColumnType type;
+        ValueFunc value;
+        TextFunc text;
+
+        Column(const char *name, ColumnType type, ValueFunc value)
+            : name(name), type(type), value(value), text(nullptr) {}
+        Column(const char *name, TextFunc text)
+            : name(name), type(ColumnType::String), value(nullptr), text(text) {}
+    };
+
+    template<size_t Index>
+    uint64_t PaletteHash(const ArchiveRow &row)
+    {
+        return row.paletteHashes[Index];
+    }
+
+    const std::vector<Column<ArchiveRow>> ArchiveColumns = {
+        {"archive",      ColumnType::UInt32, [](const ArchiveRow &row) -> uint64_t { return row.id; }},
+        {"path",         [](const ArchiveRow &row) -> const std::string& { return row.path; }},
+        {"type",         [](const ArchiveRow &row) -> const std::string& { return row.type; }},
+        {"fileSize",     ColumnType::UInt64, [](const ArchiveRow &row) -> uint64_t { return row.fileSize; }},
+        {"u1",           ColumnType::UInt32, [](const ArchiveRow &row) -> uint64_t { return row.header.u1; }},
+        {"u2",           ColumnType::UInt32, [](const ArchiveRow &row) -> uint64_t { return row.header.u2; }},
+        {"u3",           ColumnType::UInt32, [](const ArchiveRow &row) -> uint64_t { return row.header.u3; }},
+        {"imageCount",   ColumnType::UInt32, [](const ArchiveRow &row) -> uint64_t { return row.header.imageCount; }},
+        {"u4",           ColumnType::UInt32, [](const ArchiveRow &row) -> uint64_t { return row.header.u4; }},
+        {"dataClass",    ColumnType::UInt32, [](const ArchiveRow &row) -> uint64_t { return row.header.dataClass; }},
+        {"u5",           ColumnType::UInt32, [](const ArchiveRow &row) -> uint64_t { return row.header.u5; }},
+        {"u6",           ColumnType::UInt32, [](const ArchiveRow &row) -> uint64_t { return row.header.u6; }},
+        {"sizeCategory", ColumnType::UInt32, [](const ArchiveRow &row) -> uint64_t { return row.header.sizeCategory; }},
+        {"u7",           ColumnType::UInt32, [](const ArchiveRow &row) -> uint64_t { return row.header.u7; }},
+        {"u8",           ColumnType::UInt32, [](const ArchiveRow &row) -> uint64_t { return row.header.u8; }},
+        {"u9",           ColumnType::UInt32, [](const ArchiveRow &row) -> uint64_t { return row.header.u9; }},
+        {"width",        ColumnType::UInt32, [](const ArchiveRow &row) -> uint64_t { return row.header.width; }},
+        {"height",       ColumnType::UInt32, [](const ArchiveRow &row) -> uint64_t { return row.header.height; }},
+        {"u10",          ColumnType::UInt32, [](const ArchiveRow &row) -> uint64_t { return row.header.u10; }},
+        {"u11",          ColumnType::UInt32, [](const ArchiveRow &row) -> uint64_t { return row.header.u11; }},
+        {"u12",          ColumnType::UInt32, [](const ArchiveRow &row) -> uint64_t { return row.header.u12; }},
+        {"u13",          ColumnType::UInt32, [](const ArchiveRow &row) -> uint64_t { return row.header.u13; }},
+        {"anchorX",      ColumnType::UInt32, [](const ArchiveRow &row) -> uint64_t { return row.header.anchorX; }},
+        {"anchorY",      ColumnType::UInt32, [](const ArchiveRow &row) -> uint64_t { return row.header.anchorY; }},
+        {"dataSize",     ColumnType::UInt32, [](const ArchiveRow &row) -> uint64_t { return row.header.dataSize; }},
+        {"u14",          ColumnType::UInt32, [](const ArchiveRow &row) -> uint64_t { return row.header.u14; }},
+        {"palette0",     ColumnType::UInt64, PaletteHash<0>},
+        {"palette1",     ColumnType::UInt64, PaletteHash<1>},
+        {"palette2",     ColumnType::UInt64, PaletteHash<2>},
+        {"palette3",     ColumnType::UInt64, PaletteHash<3>},
+        {"palette4",     ColumnType::UInt64, PaletteHash<4>},
+        {"palette5",     ColumnType::UInt64, PaletteHash<5>},
+        {"palette6",     ColumnType::UInt64, PaletteHash<6>},
+        {"palette7",     ColumnType::UInt64, PaletteHash<7>},
+        {"palette8",     ColumnType::UInt64, PaletteHash<8>},
+        {"palette9",     ColumnType::UInt64, PaletteHash<9>}
+    };
+
+    const std::vector<Column<EntryRow>> EntryColumns = {
+        {"archive",      ColumnType::UInt32, [](const EntryRow &row) -> uint64_t { return row.archive; }},
+        {"index",        ColumnType::UInt32, [](const EntryRow &row) -> uint64_t { return row.index; }},
+        {"offset",       ColumnType::UInt32, [](const EntryRow &row) -> uint64_t { return row.offset; }},
+        {"size",         ColumnType::UInt32, [](const EntryRow &row) -> uint64_t { return row.size; }},
+        {"width",        ColumnType::UInt16, [](const EntryRow &row) -> uint64_t { return row.header.width; }},
+        {"height",       ColumnType::UInt16, [](const EntryRow &row) -> uint64_t { return row.header.height; }},
+        {"posX",         ColumnType::UInt16, [](const EntryRow &row) -> uint64_t { return row.header.posX; }},
+        {"posY",         ColumnType::UInt16, [](const EntryRow &row) -> uint64_t { return row.header.posY; }},
+        {"group",        ColumnType::UInt8,  [](const EntryRow &row) -> uint64_t { return row.header.group; }},
+        {"groupSize",    ColumnType::UInt8,  [](const EntryRow &row) -> uint64_t { return row.header.groupSize; }},
+        {"tileY",        ColumnType::Int16,  [](const EntryRow &row) -> uint64_t { return static_cast<int64_t>(row.header.tileY); }},
+        {"tileOrient",   ColumnType::UInt8,  [](const EntryRow &row) -> uint64_t { return row.header.tileOrient; }},
+        {"hOffset",      ColumnType::UInt8,  [](const EntryRow &row) -> uint64_t { return row.header.hOffset; }},
+        {"boxWidth",     ColumnType::UInt8,  [](const EntryRow &row) -> uint64_t { return row.header.boxWidth; }},
+        {"flags",        ColumnType::UInt8,  [](const EntryRow &row) -> uint64_t { return row.header.flags; }}
+    };
+
+    uint64_t HashPalette(const core::Palette &palette)
+    {
+        // FNV-1a over RGBA of colors, it is the same on every platform
+        uint64_t hash = 14695981039346656037ull;
+        for(const SDL_Color &color : palette) {
+            for(uint8_t byte : {color.r, color.g, color.b, color.a}) {
+                hash ^= byte;
+                hash *= 1099511628211ull;
+            }
+        }
+        return hash;
+    }
+
+    /**
+     * Formats cells straight into a reusable buffer, which is written
+     * out in large pieces. Nothing is allocated per cell.
+     */
+    class CsvWriter
+    {
+        static const size_t FlushThreshold = 64 * 1024;
+
+        std::ostream &mOut;
+        std::vector<char> mBuffer;
+        bool mFirstCell = true;
+
+        void Separate() {
+            if(!mFirstCell) {
+                mBuffer.push_back(',');
+            }
+            mFirstCell = false;
+        }
+
+    public:
+        explicit CsvWriter(std::ostream &out)
+            : mOut(out)
+        {
+            mBuffer.reserve(FlushThreshold + 1024);
+        }
+
+        void Unsigned(uint64_t value) {
+            Separate();
+            char digits[20];
+            size_t count = 0;
+            do {
+                digits[count++] = '0' + (value % 10);
+                value /= 10;
+            } while(value != 0);
+            while(count != 0) {
+                mBuffer.push_back(digits[--count]);
+            }
+        }
+
+        void Signed(int64_t value) {
+            if(value < 0) {
+                Separate();
+                mBuffer.push_back('-');
+                mFirstCell = true;
+                Unsigned(0 - static_cast<uint64_t>(value));
+            } else {
+                Unsigned(value);
+            }
+        }
+
+        void Text(const std::string &text) {
+            Separate();
+            if(text.find_first_of(",\"\r\n") == std::string::npos) {
+                mBuffer.insert(mBuffer.end(), text.begin(), text.end());
+                return;
+            }
+
+            mBuffer.push_back('"');
+            for(char c : text) {
+                if(c == '"') {
+                    mBuffer.push_back('"');
+                }
+                mBuffer.push_back(c);
+            }
+            mBuffer.push_back('"');
+        }
+
+        void EndRow() {
+            mBuffer.push_back('\n');
+            mFirstCell = true;
+            if(mBuffer.size() >= FlushThreshold) {
+                Flush();
+            }
+        }
+
+        void Flush() {
+            mOut.write(mBuffer.data(), mBuffer.size());
+            mBuffer.clear();
+        }
+    };
+
+    template<class Row>
+    void WriteCSV(std::ostream &out, const std::vector<Column<Row>> &columns, const std::vector<Row> &rows)
+    {
+        CsvWriter csv(out);
+        for(const Column<Row> &column : columns) {
+            csv.Text(column.name);
+        }
+        csv.EndRow();
+
+        for(const Row &row : rows) {
+            for(const Column<Row> &column : columns) {
+                switch(column.type) {
+                case ColumnType::String:
+                    csv.Text(column.text(row));
+                    break;
+
+                case ColumnType::Int16:
+                    csv.Signed(column.value(row));
+                    break;
+
+                default:
+                    csv.Unsigned(column.value(row));
+                    break;
+                }
+            }
+            csv.EndRow();
+        }
+        csv.Flush();
+    }
+
+    template<class T>
+    void AppendLittle(std::vector<char> &buffer, T value)
+    {
+        const T swapped = core::SwapLittle(value);
+        const char *bytes = reinterpret_cast<const char*>(&swapped);
+        buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+    }
+
+    template<class Row>
+    void AppendColumn(std::vector<char> &data, const Column<Row> &column, const std::vector<Row> &rows)
+    {
+        for(const Row &row : rows) {
+            switch(column.type) {
+            case ColumnType::UInt8:
+                AppendLittle<uint8_t>(data, column.value(row));
+                break;
+
+            case ColumnType::UInt16:
+            case ColumnType::Int16:
+                AppendLittle<uint16_t>(data, column.value(row));
+                break;
+
+            case ColumnType::UInt32:
+                AppendLittle<uint32_t>(data, column.value(row));
+                break;
+
+            case ColumnType::UInt64:
+                AppendLittle<uint64_t>(data, column.value(row));
+                break;
+
+            case ColumnType::String:
+                {
+                    const std::string &text = column.text(row);
+                    AppendLittle<uint32_t>(data, text.size());
+                    data.insert(data.end(), text.begin(), text.end());
+                }
+                break;
+            }
+        }
+    }
+
+    /**
+     * Layout is magic, version, number of columns and rows; then for every
+     * column: type code, name length, name, data length and data.
+     */
+    template<class Row>
+    void WriteColumns(std::ostream &out, const std::vector<Column<Row>> &columns, const std::vector<Row> &rows)
+    {
+        std::vector<char> data;
+        data.insert(data.end(), ColumnsMagic, ColumnsMagic + sizeof(ColumnsMagic));
+        AppendLittle<uint32_t>(data, ColumnsVersion);
+        AppendLittle<uint32_t>(data, columns.size());
+        AppendLittle<uint64_t>(data, rows.size());
+        out.write(data.data(), data.size());
+
+        for(const Column<Row> &column : columns) {
+            data.clear();
+            AppendColumn(data, column, rows);
+
+            std::vector<char> prefix;
+            const size_t nameLength = strlen(column.name);
+            AppendLittle<uint8_t>(prefix, static_cast<uint8_t>(column.type));
+            AppendLittle<uint8_t>(prefix, nameLength);
+            prefix.insert(prefix.end(), column.name, column.name + nameLength);
+            AppendLittle<uint64_t>(prefix, data.size());
+
+            out.write(prefix.data(), prefix.size());
+            out.write(data.data(), data.size());
+        }
+    }
+
+    template<class Row>
+    void WriteTable(const boost::filesystem::path &path, bool csv, const std::vector<Column<Row>> &columns, const std::vector<Row> &rows)
+    {
+        boost::filesystem::ofstream fout(path, std::ios_base::binary | std::ios_base::out);
+        if(!fout) {
+            throw std::runtime_error(strerror(errno));
+        }
+
+        if(csv) {
+            WriteCSV(fout, columns, rows);
+        } else {
+            WriteColumns(fout, columns, rows);
+        }
+
+        if(!fout) {
+            throw std::runtime_error(strerror(errno));
+        }
+    }
+}
+
+namespace gmtool
+{
+    void ExportMode::GetOptions(po::options_description &opts)
+    {
+        po::options_description mode("Export mode");
+        mode.add_options()
+            ("files",             po::value(&mInputFiles),                                               "Set GM1 filenames or directories")
+            ("manifest",          po::value(&mManifestFile),                                             "Read GM1 filenames from the file, one per line")
+            ("output,o",          po::value(&mOutputDir)->required(),                                    "Set output directory")
+            ("format,f",          po::value(&mFormat)->default_value("csv"),                             "Set table format: csv or columns")
+            ("jobs,j",            po::value(&mNumJobs)->default_value(core::HardwareConcurrency()),      "Set number of threads reading collections")
+            ;
+        opts.add(mode);
+    }
+
+    void ExportMode::GetPositionalOptions(po::positional_options_description &unnamed)
+    {
+        unnamed.add("files", -1);
+    }
+
+    void ExportMode::PrintUsage(std::ostream &out)
+    {
+        out << "Usage: gmtool export -o <output dir> <files or directories...>" << std::endl;
+        out << "Writes archives.<ext> and entries.<ext> tables joined by `archive' column." << std::endl;
+        out << "Allowed formats are:" << std::endl;
+        out << "   csv      Comma separated values with a heading row" << std::endl;
+        out << "   columns  Columnar little-endian binary" << std::endl;
+    }
+
+    int ExportMode::Exec(const ModeConfig &cfg)
+    {
+        const bool csv = (mFormat == "csv");
+        if(!csv && mFormat != "columns") {
+            throw std::logic_error("Format should be either csv or columns");
+        }
+
+        if(mNumJobs == 0) {
+            throw std::logic_error("Number of jobs should be positive");
+        }
+
+        const std::vector<boost::filesystem::path> files = FindCollectionFiles(mInputFiles, mManifestFile);
+        if(files.empty()) {
+            throw std::logic_error("No collections to export");
+        }
+
+        cfg.verbose << "Reading " << files.size() << " collections using " << mNumJobs << " jobs" << std::endl;
+
+        std::vector<ArchiveRow> archives(files.size());
+        std::vector<std::vector<EntryRow>> entries(files.size());
+        core::ParallelFor(files.size(), mNumJobs, [&](size_t id) {
+                // Only the preamble is read without flags, entry data is never touched
+                gm1::GM1Reader reader;
+                try {
+                    reader.Open(files[id], gm1::GM1Reader::NoFlags);
+                } catch(const std::exception &error) {
+                    throw std::runtime_error(files[id].string() + ": " + error.what());
+                }
+
+                ArchiveRow &archive = archives[id];
+                archive.id = id;
+                archive.path = files[id].string();
+                archive.type = gm1::GetArchiveTypeName(reader.ArchiveType());
+                archive.fileSize = boost::filesystem::file_size(files[id]);
+                archive.header = reader.Header();
+                for(size_t i = 0; i < gm1::CollectionPaletteCount; ++i) {
+                    archive.paletteHashes[i] = (i < reader.NumPalettes())
+                        ? HashPalette(reader.Palette(i))
+                        : 0;
+                }
+
+                std::vector<EntryRow> &rows = entries[id];
+                rows.resize(reader.NumEntries());
+                for(size_t index = 0; index < rows.size(); ++index) {
+                    rows[index] = EntryRow {
+                        static_cast<uint32_t>(id),
+                        static_cast<uint32_t>(index),
+                        static_cast<uint32_t>(reader.EntryOffset(index)),
+                        static_cast<uint32_t>(reader.EntrySize(index)),
+                        reader.EntryHeader(index)
+                    };
+                }
+            });
+
+        std::vector<EntryRow> allEntries;
+        for(std::vector<EntryRow> &rows : entries) {
+            allEntries.insert(allEntries.end(), rows.begin(), rows.end());
+            std::vector<EntryRow>().swap(rows);
+        }
+
+        if(!boost::filesystem::exists(mOutputDir)) {
+            cfg.verbose << "Create directory " << mOutputDir << std::endl;
+            boost::filesystem::create_directories(mOutputDir);
+        }
+
+        const std::string ext = csv ? ".csv" : ".col";
+        WriteTable(mOutputDir / ("archives" + ext), csv, ArchiveColumns, archives);
+        WriteTable(mOutputDir / ("entries" + ext), csv, EntryColumns, allEntries);
+
+        cfg.verbose << archives.size() << " collections and " << allEntries.size() << " entries exported" << std::endl;
+        return EXIT_SUCCESS;
+    }
+}
@@ -0,0 +1,37 @@
+#ifndef EXPORTMODE_H_
+#define EXPORTMODE_H_
+
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem/path.hpp>
+
+#include <gmtool/mode.h>
+
+namespace gmtool
+{
+    /**
+     * \brief Dumps metadata of many collections into two tables.
+     *
+     * `archives' table has a row per collection with its header and
+     * palette hashes, `entries' table has a row per entry with its offset,
+     * size and header. Tables are written either as CSV or as columnar binary.
+     */
+    class ExportMode : public Mode
+    {
+        std::vector<boost::filesystem::path> mInputFiles;
+        boost::filesystem::path mManifestFile;
+        boost::filesystem::path mOutputDir;
+        std::string mFormat;
+        size_t mNumJobs = 1;
+
+    public:
+        void PrintUsage(std::ostream &out);
+        void GetOptions(boost::program_options::options_description&);
+        void GetPositionalOptions(boost::program_options::positional_options_description&);
+        int Exec(const ModeConfig &config);
+    };
+}
+
+#endif // EXPORTMODE_H_
@@ -27,6 +27,10 @@
 #include <gmtool/dumpmode.h>
 #include <gmtool/packmode.h>
 #include <gmtool/unpackmode.h>
+#include <gmtool/atlasmode.h>
+#include <gmtool/sheetmode.h>
+#include <gmtool/batchmode.h>
+#include <gmtool/exportmode.h>
 #include <gmtool/rendermode.h>
 
 int main(int argc, const char *argv[])
@@ -96,8 +100,12 @@ namespace gmtool
         {"list",    "List entries of gm1 collection",      Mode::Ptr(new ListMode)},
         {"dump",    "Dump entry data onto stdout",         Mode::Ptr(new DumpMode)},
         {"render",  "Convert entry into trivial image",    Mode::Ptr(new RenderMode)},
-        {"unpack",  "Unpack gm1 collection",               Mode::Ptr(nullptr)},
-        {"pack",    "Pack directory into gm1",             Mode::Ptr(nullptr)},
+        {"unpack",  "Unpack gm1 collection",               Mode::Ptr(new UnpackMode)},
+        {"pack",    "Pack directory into gm1",             Mode::Ptr(new PackMode)},
+        {"atlas",   "Pack entries into texture pages",     Mode::Ptr(new AtlasMode)},
+        {"sheet",   "Lay out entries into a single image", Mode::Ptr(new SheetMode)},
+        {"batch",   "Process many collections at once",    Mode::Ptr(new BatchMode)},
+        {"export",  "Export metadata of many collections", Mode::Ptr(new ExportMode)},
         {"init",    "Create empty unpacked gm1 directory", Mode::Ptr(nullptr)}
     };
     
@@ -110,6 +118,7 @@ namespace gmtool
         bool allowVerbose = false;
         bool noUnusedBytes = false;
         std::string modeName;
+        boost::filesystem::path cacheDir;
         
         po::options_description visible("Allowed options");
         visible.add_options()
@@ -117,6 +126,7 @@ namespace gmtool
             ("version", po::bool_switch(&versionRequested), "show version")
             ("verbose,v", po::bool_switch(&allowVerbose), "allow verbose messages")
             ("no-unused-bytes", po::bool_switch(&noUnusedBytes), "report any unused bytes in file")
+            ("cache-dir", po::value(&cacheDir), "keep decoded entries in the directory")
             ;
 
         std::vector<std::string> extras;
@@ -166,7 +176,7 @@ namespace gmtool
         /** Dummy stream for disallowed verbose messages **/
         std::ostringstream logging;
         std::ostream &verbose = (allowVerbose ? std::clog : logging);
-        ModeConfig config {helpRequested, versionRequested, allowVerbose, verbose, std::cout};
+        ModeConfig config {helpRequested, versionRequested, allowVerbose, verbose, std::cout, cacheDir};
         
         for(const Command &lookup : commands) {
             if(lookup.name == modeName) {
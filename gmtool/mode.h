@@ -27,6 +27,7 @@ namespace gmtool
         bool verboseRequested;
         std::ostream &verbose;
         std::ostream &stdout;
+        boost::filesystem::path cacheDir;
     };
     
     class Mode
@@ -1,5 +1,153 @@
 #include "packmode.h"
 
+#include <cerrno>
+#include <cstring>
+
+#include <atomic>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+#include <boost/filesystem/fstream.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <boost/program_options/options_description.hpp>
+#include <boost/program_options/positional_options.hpp>
+
+#include <gmtool/renderer.h>
+
+#include <gm1/gm1.h>
+#include <gm1/gm1reader.h>
+#include <gm1/gm1writer.h>
+#include <gm1/gm1entrywriter.h>
+
+#include <tgx/tgx.h>
+
+#include <core/image.h>
+#include <core/palette.h>
+#include <core/color.h>
+#include <core/parallel.h>
+
+namespace po = boost::program_options;
+
 namespace gmtool
 {
+    PackMode::~PackMode() throw() = default;
+    PackMode::PackMode()
+    {
+        mFormats = RenderFormats();
+    }
+
+    void PackMode::GetOptions(po::options_description &opts)
+    {
+        po::options_description mode("Pack mode");
+        mode.add_options()
+            ("dir",               po::value(&mInputDir)->required(),                                     "Set directory with entry images")
+            ("output,o",          po::value(&mOutputFile)->required(),                                   "Set output GM1 filename")
+            ("template,t",        po::value(&mTemplateFile)->required(),                                 "Set GM1 file to take headers and palettes from")
+            ("format,f",          po::value(&mFormat)->default_value(mFormats.front().name),             "Set entry file format")
+            ("palette,p",         po::value(&mPaletteIndex),                                             "Set palette index for 8-bit entries")
+            ("transparent-color", po::value(&mTransparentColor)->default_value(DefaultTransparentColor()), "Set background color in #AARRGGBB format")
+            ("jobs,j",            po::value(&mNumJobs)->default_value(core::HardwareConcurrency()),      "Set number of encoding threads")
+            ("optimal",           po::bool_switch(&mOptimal),                                            "Produce the smallest tgx entries (slower)")
+            ;
+        opts.add(mode);
+    }
+
+    void PackMode::GetPositionalOptions(po::positional_options_description &unnamed)
+    {
+        unnamed.add("dir", 1);
+        unnamed.add("output", 1);
+    }
+
+    void PackMode::PrintUsage(std::ostream &out)
+    {
+        out << "Allowed entry formats are:" << std::endl;
+        PrintRenderFormats(out, mFormats);
+    }
+
+    const boost::filesystem::path PackMode::EntryPath(size_t index, const std::string &format) const
+    {
+        std::ostringstream oss;
+        oss << std::setw(5) << std::setfill('0') << index << '.' << format;
+        return mInputDir / oss.str();
+    }
+
+    int PackMode::Exec(const ModeConfig &cfg)
+    {
+        cfg.verbose << "Reading template " << mTemplateFile << std::endl;
+        gm1::GM1Reader reader(mTemplateFile, gm1::GM1Reader::Mapped);
+
+        if(mPaletteIndex >= reader.NumPalettes()) {
+            throw std::logic_error("Palette index is out of range");
+        }
+
+        if(mNumJobs == 0) {
+            throw std::logic_error("Number of jobs should be positive");
+        }
+
+        cfg.verbose << "Find appropriate format" << std::endl;
+        const RenderFormat &result = FindRenderFormat(mFormats, mFormat);
+        result.renderer->SetTransparentColor(mTransparentColor);
+
+        gm1::GM1EntryWriter::Ptr writer = gm1::CreateEntryWriter(reader.ArchiveType());
+        writer->Transparent(mTransparentColor);
+        writer->Palette(reader.Palette(mPaletteIndex));
+        writer->Encoding(mOptimal ? tgx::Encoding::Optimal : tgx::Encoding::Greedy);
+
+        std::vector<gm1::EntryHeader> headers;
+        headers.reserve(reader.NumEntries());
+        for(size_t index = 0; index < reader.NumEntries(); ++index) {
+            headers.push_back(reader.EntryHeader(index));
+        }
+
+        cfg.verbose << "Packing " << mInputDir << " using " << mNumJobs << " jobs" << std::endl;
+        std::vector<std::string> entries(reader.NumEntries());
+        std::atomic<size_t> numCopied(0);
+
+        core::ParallelFor(reader.NumEntries(), mNumJobs, [&](size_t index) {
+                const boost::filesystem::path path = EntryPath(index, result.name);
+                if(!boost::filesystem::exists(path)) {
+                    const char *data = reader.EntryData(index);
+                    entries[index].assign(data, reader.EntrySize(index));
+                    ++numCopied;
+                    return;
+                }
+
+                boost::filesystem::ifstream fin(path, std::ios_base::binary | std::ios_base::in);
+                if(!fin) {
+                    throw std::runtime_error(strerror(errno));
+                }
+                const core::Image image = result.renderer->LoadFromStream(fin);
+
+                std::ostringstream oss;
+                writer->Save(oss, image, headers[index]);
+                if(!oss) {
+                    throw std::runtime_error("Unable to encode entry");
+                }
+                entries[index] = oss.str();
+            });
+
+        if(numCopied != 0) {
+            cfg.verbose << numCopied << " entries copied from template" << std::endl;
+        }
+
+        std::vector<core::Palette> palettes;
+        for(size_t index = 0; index < reader.NumPalettes(); ++index) {
+            palettes.push_back(reader.Palette(index));
+        }
+
+        cfg.verbose << "Writing file " << mOutputFile << std::endl;
+        boost::filesystem::ofstream fout(mOutputFile, std::ios_base::binary | std::ios_base::out);
+        if(!fout) {
+            throw std::runtime_error(strerror(errno));
+        }
+
+        gm1::WriteCollection(fout, reader.Header(), palettes, headers, entries);
+        if(!fout) {
+            throw std::runtime_error(strerror(errno));
+        }
+
+        cfg.verbose << entries.size() << " entries packed" << std::endl;
+        return EXIT_SUCCESS;
+    }
 }
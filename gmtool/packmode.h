@@ -1,6 +1,53 @@
 #ifndef PACKMODE_H_
 #define PACKMODE_H_
 
-#include "mode.h"
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem/path.hpp>
+
+#include <gmtool/mode.h>
+
+#include <core/color.h>
+
+namespace gmtool
+{
+    class RenderFormat;
+}
+
+namespace gmtool
+{
+    /**
+     * \brief Inverse of the unpack mode.
+     *
+     * Collection header, palettes and entry headers are taken from the
+     * template collection, entry images are read from the directory.
+     * Entries which have no image are copied from the template as is.
+     */
+    class PackMode : public Mode
+    {
+        boost::filesystem::path mInputDir;
+        boost::filesystem::path mOutputFile;
+        boost::filesystem::path mTemplateFile;
+        std::string mFormat;
+        size_t mPaletteIndex = 0;
+        size_t mNumJobs = 1;
+        bool mOptimal = false;
+        core::Color mTransparentColor;
+        std::vector<RenderFormat> mFormats;
+
+        const boost::filesystem::path EntryPath(size_t index, const std::string &format) const;
+
+    public:
+        PackMode();
+        virtual ~PackMode() throw();
+
+        void PrintUsage(std::ostream &out);
+        void GetOptions(boost::program_options::options_description&);
+        void GetPositionalOptions(boost::program_options::positional_options_description&);
+        int Exec(const ModeConfig &config);
+    };
+}
 
 #endif // PACKMODE_H_
@@ -2,13 +2,20 @@
 
 #include "config_gmtool.h"
 
+#include <algorithm>
 #include <vector>
 #include <iostream>
+#include <iterator>
 #include <stdexcept>
 
 #include <core/sdl_error.h>
 #include <core/sdl_utils.h>
 #include <core/rw.h>
+#include <core/image.h>
+#include <core/palette.h>
+#include <core/color.h>
+
+#include <gm1/gm1.h>
 
 #include "renderers/bitmap.h"
 #include "renderers/tgxrenderer.h"
@@ -33,6 +40,49 @@ namespace gmtool
         };
     }
 
+    const core::Color DefaultTransparentColor()
+    {
+        return core::Color(255, 0, 255, 255);
+    }
+
+    const RenderFormat& FindRenderFormat(const std::vector<RenderFormat> &formats, const std::string &name)
+    {
+        for(const RenderFormat &format : formats) {
+            if(format.name == name)
+                return format;
+        }
+
+        throw std::logic_error("No format with such name");
+    }
+
+    void PrintRenderFormats(std::ostream &out, const std::vector<RenderFormat> &formats)
+    {
+        for(const RenderFormat &format : formats) {
+            out.width(3);
+            out << ' ';
+            out << format.name;
+            out << std::endl;
+        }
+    }
+
+    void PrepareEntryForRender(core::Image &image, const core::Palette &palette)
+    {
+        if(!core::IsPalettized(image)) {
+            return;
+        }
+
+        core::Palette copied(palette.Size());
+        std::copy(palette.begin(), palette.end(), copied.begin());
+        image.AttachPalette(copied);
+
+        const bool keyed = image.ColorKeyEnabled();
+        const core::Color key = image.GetColorKey();
+        image = core::ConvertImage(image, gm1::PalettePixelFormat);
+        if(keyed) {
+            image.SetColorKey(key);
+        }
+    }
+
     void Renderer::RenderToSDL_RWops(SDL_RWops *dst, const core::Image &surface)
     {
         throw std::runtime_error("You should implement Renderer::RenderToSDL_RWops()");
@@ -40,11 +90,45 @@ namespace gmtool
     
     void Renderer::RenderToStream(std::ostream &out, const core::Image &surface)
     {
-        RWPtr rw(core::SDL_RWFromOutputStream(out));
+        // Image is rendered into memory and passed to the stream at once,
+        // so the stream is never seeked and may be a pipe.
+        std::vector<char> buffer;
+        RWPtr rw(core::SDL_RWFromBuffer(buffer));
         if(rw) {
             RenderToSDL_RWops(rw.get(), surface);
         } else {
             throw sdl_error();
         }
+
+        if(!out.write(buffer.data(), buffer.size())) {
+            throw std::runtime_error("Unable to write image");
+        }
+    }
+
+    const core::Image Renderer::LoadFromSDL_RWops(SDL_RWops *src)
+    {
+        throw std::runtime_error("You should implement Renderer::LoadFromSDL_RWops()");
+    }
+
+    const core::Image Renderer::LoadFromStream(std::istream &in)
+    {
+        std::vector<char> buffer {std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+        RWPtr rw(core::SDL_RWFromBuffer(buffer));
+        if(rw) {
+            return LoadFromSDL_RWops(rw.get());
+        } else {
+            throw sdl_error();
+        }
+    }
+
+    void Renderer::SetCompressionLevel(int level)
+    {
+        if(level < -1 || level > 9) {
+            throw std::invalid_argument("Compression level should be in range -1..9");
+        }
+    }
+
+    void Renderer::SetTransparentColor(const core::Color &color)
+    {
     }
 }
@@ -10,7 +10,9 @@
 
 namespace core
 {
+    class Color;
     class Image;
+    class Palette;
 }
 
 namespace gmtool
@@ -20,6 +22,24 @@ namespace gmtool
         typedef std::shared_ptr<Renderer> Ptr;
         virtual void RenderToSDL_RWops(SDL_RWops *dst, const core::Image &surface);
         virtual void RenderToStream(std::ostream &out, const core::Image &surface);
+        virtual const core::Image LoadFromSDL_RWops(SDL_RWops *src);
+        virtual const core::Image LoadFromStream(std::istream &in);
+
+        /**
+         * \brief Sets compression level of following renders, -1 is the format default.
+         *
+         * Formats without adjustable compression ignore it.
+         *
+         * \throw std::invalid_argument if level is out of range.
+         */
+        virtual void SetCompressionLevel(int level);
+
+        /**
+         * \brief Sets color of pixels which are missing in loaded files.
+         *
+         * Formats which store transparency themselves ignore it.
+         */
+        virtual void SetTransparentColor(const core::Color &color);
     };
     
     struct RenderFormat
@@ -29,6 +49,26 @@ namespace gmtool
     };
 
     std::vector<RenderFormat> RenderFormats();
+
+    /**
+     * \brief Color of transparent pixels in rendered entries unless overridden.
+     */
+    const core::Color DefaultTransparentColor();
+
+    /**
+     * \throw std::logic_error if there is no format with such name.
+     */
+    const RenderFormat& FindRenderFormat(const std::vector<RenderFormat> &formats, const std::string &name);
+    void PrintRenderFormats(std::ostream &out, const std::vector<RenderFormat> &formats);
+
+    /**
+     * \brief Makes decoded entry ready to be written by any renderer.
+     *
+     * 8-bit entries get their own copy of the palette, since SDL_Palette
+     * refcount is not atomic, and are expanded into gm1::PalettePixelFormat.
+     * Color key is kept: on indexed image it would match the nearest palette entry.
+     */
+    void PrepareEntryForRender(core::Image &image, const core::Palette &palette);
 }
 
 #endif // RENDERER_H_
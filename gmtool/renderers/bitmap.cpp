@@ -3,6 +3,7 @@
 #include <SDL.h>
 
 #include <core/image.h>
+#include <core/sdl_error.h>
 
 namespace gmtool
 {
@@ -10,4 +11,13 @@ namespace gmtool
     {
         SDL_SaveBMP_RW(image.GetSurface(), out, SDL_FALSE);
     }
+
+    const core::Image BitmapFormat::LoadFromSDL_RWops(SDL_RWops *src)
+    {
+        core::Image image(SDL_LoadBMP_RW(src, SDL_FALSE));
+        if(image.Null()) {
+            throw sdl_error();
+        }
+        return image;
+    }
 }
@@ -13,6 +13,7 @@ namespace gmtool
     struct BitmapFormat : public Renderer
     {
         void RenderToSDL_RWops(SDL_RWops *dst, const core::Image &surface);
+        const core::Image LoadFromSDL_RWops(SDL_RWops *src);
     };
 }
 
@@ -1,19 +1,82 @@
 #include "pngrenderer.h"
 
+#include <iostream>
 #include <stdexcept>
+#include <vector>
 
 #include <core/image.h>
+#include <core/pngwriter.h>
 
 #include <SDL_image.h>
 
+namespace
+{
+    struct PNGInitializer
+    {
+        PNGInitializer() {
+            IMG_Init(IMG_INIT_PNG);
+        }
+        
+        ~PNGInitializer() {
+            IMG_Quit();
+        }
+    };
+
+    /**
+       Writing goes around SDL_image: the encoder keeps its deflate state
+       and output buffer between images of the same thread.
+    **/
+    const std::vector<char>& EncodePNG(const core::Image &image, int level)
+    {
+        static thread_local core::PNGWriter writer;
+        static thread_local std::vector<char> buffer;
+        if(writer.CompressionLevel() != level) {
+            writer.SetCompressionLevel(level);
+        }
+        writer.Write(image, buffer);
+        return buffer;
+    }
+}
+
 namespace gmtool
 {
+    PNGRenderer::PNGRenderer()
+        : mCompressionLevel(-1)
+    {
+    }
+
     void PNGRenderer::RenderToSDL_RWops(SDL_RWops *out, const core::Image &image)
     {
-        IMG_Init(IMG_INIT_PNG);
-        if(IMG_SavePNG_RW(image.GetSurface(), out, SDL_FALSE) < 0) {
+        const std::vector<char> &buffer = EncodePNG(image, mCompressionLevel);
+        if(SDL_RWwrite(out, buffer.data(), 1, buffer.size()) != buffer.size()) {
+            throw std::runtime_error(SDL_GetError());
+        }
+    }
+
+    void PNGRenderer::RenderToStream(std::ostream &out, const core::Image &image)
+    {
+        const std::vector<char> &buffer = EncodePNG(image, mCompressionLevel);
+        if(!out.write(buffer.data(), buffer.size())) {
+            throw std::runtime_error("Unable to write PNG");
+        }
+    }
+
+    const core::Image PNGRenderer::LoadFromSDL_RWops(SDL_RWops *src)
+    {
+        // IMG_Quit would unload libpng under the feet of other rendering threads,
+        // so SDL_image is initialized only once per process.
+        static const PNGInitializer init;
+
+        core::Image image(IMG_LoadTyped_RW(src, SDL_FALSE, "PNG"));
+        if(image.Null()) {
             throw std::runtime_error(IMG_GetError());
         }
-        IMG_Quit();
+        return image;
+    }
+
+    void PNGRenderer::SetCompressionLevel(int level)
+    {
+        Renderer::SetCompressionLevel(level);
+        mCompressionLevel = level;
     }
 }
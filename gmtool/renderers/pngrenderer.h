@@ -1,13 +1,22 @@
 #ifndef PNGRENDERER_H_
 #define PNGRENDERER_H_
 
+#include <atomic>
+
 #include <gmtool/renderer.h>
 
 namespace gmtool
 {
     struct PNGRenderer : public Renderer
     {
+        PNGRenderer();
         void RenderToSDL_RWops(SDL_RWops *dst, const core::Image &surface);
+        void RenderToStream(std::ostream &out, const core::Image &surface);
+        const core::Image LoadFromSDL_RWops(SDL_RWops *src);
+        void SetCompressionLevel(int level);
+
+    private:
+        std::atomic<int> mCompressionLevel;
     };
 }
 
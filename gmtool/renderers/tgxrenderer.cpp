@@ -2,12 +2,44 @@
 
 #include <iostream>
 
+#include <core/image.h>
+#include <core/color.h>
+
 #include <tgx/tgx.h>
 
 namespace gmtool
 {
+    TGXRenderer::TGXRenderer()
+        : mTransparentColor(DefaultTransparentColor())
+    {
+    }
+
     void TGXRenderer::RenderToStream(std::ostream &out, const core::Image &image)
     {
         tgx::WriteImage(out, image);
     }
+
+    const core::Image TGXRenderer::LoadFromStream(std::istream &in)
+    {
+        core::Image image;
+        tgx::ReadImageHeader(in, image);
+
+        // Transparent pixels are skipped by the decoder, so they should be
+        // distinguishable from black ones.
+        core::ClearImage(image, mTransparentColor);
+        image.SetColorKey(mTransparentColor);
+
+        const std::streampos origin = in.tellg();
+        in.seekg(0, std::ios_base::end);
+        const std::streampos fsize = in.tellg();
+        in.seekg(origin);
+
+        tgx::DecodeImage(in, fsize - origin, image);
+        return image;
+    }
+
+    void TGXRenderer::SetTransparentColor(const core::Color &color)
+    {
+        mTransparentColor = color;
+    }
 }
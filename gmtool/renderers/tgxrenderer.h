@@ -3,6 +3,8 @@
 
 #include <gmtool/renderer.h>
 
+#include <core/color.h>
+
 namespace core
 {
     class Image;
@@ -12,7 +14,13 @@ namespace gmtool
 {
     struct TGXRenderer : public Renderer
     {
+        TGXRenderer();
         virtual void RenderToStream(std::ostream &out, const core::Image &surface);
+        virtual const core::Image LoadFromStream(std::istream &in);
+        virtual void SetTransparentColor(const core::Color &color);
+
+    private:
+        core::Color mTransparentColor;
     };
 }
 
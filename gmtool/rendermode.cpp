@@ -3,6 +3,7 @@
 #include <string>
 #include <sstream>
 #include <memory>
+#include <cstdio>
 #include <cstring>
 
 #include <boost/filesystem/fstream.hpp>
@@ -20,9 +21,34 @@
 #include <core/color.h>
 #include <core/rect.h>
 #include <core/rw.h>
+#include <core/sdl_error.h>
 
 namespace po = boost::program_options;
 
+namespace
+{
+    /**
+     * Standard output may be a pipe, the descriptor adapter never seeks it.
+     */
+    const core::RWStats WriteToStandardOutput(std::ostream &out, const std::string &data)
+    {
+        out.flush();
+
+        core::RWStats stats = core::RWStats();
+        SDL_RWops *rw = core::SDL_RWFromFileDescriptor(fileno(stdout), &stats);
+        if(rw == NULL) {
+            throw sdl_error();
+        }
+
+        const bool written = (SDL_RWwrite(rw, data.data(), 1, data.size()) == data.size());
+        const bool closed = (SDL_RWclose(rw) == 0);
+        if(!written || !closed) {
+            throw sdl_error();
+        }
+        return stats;
+    }
+}
+
 namespace gmtool
 {
     RenderMode::~RenderMode() throw() = default;
@@ -37,10 +63,11 @@ namespace gmtool
         mode.add_options()
             ("file",              po::value(&mInputFile)->required(),                                    "Set GM1 filename")
             ("index,i",           po::value(&mEntryIndex)->required(),                                   "Set entry index")
-            ("output,o",          po::value(&mOutputFile),                                               "Set output image filename")
+            ("output,o",          po::value(&mOutputFile),                                               "Set output image filename, - for standard output")
             ("format,f",          po::value(&mFormat)->default_value(mFormats.front().name),             "Set render file format")
+            ("compression",       po::value(&mCompressionLevel)->default_value(mCompressionLevel),       "Set compression level 0..9, -1 for format default")
             ("palette,p",         po::value(&mPaletteIndex),                                             "Set palette index for 8-bit entries")
-            ("transparent-color", po::value(&mTransparentColor)->default_value(DefaultTransparent()),    "Set background color in #AARRGGBB format")
+            ("transparent-color", po::value(&mTransparentColor)->default_value(DefaultTransparentColor()), "Set background color in #AARRGGBB format")
             ("print-size-only",   po::bool_switch(&mEvalSizeOnly),                                       "Do not perform real rendering, but eval and print size")
             ;
         opts.add(mode);
@@ -55,41 +82,9 @@ namespace gmtool
     void RenderMode::PrintUsage(std::ostream &out)
     {
         out << "Allowed render formats are:" << std::endl;
-        for(const RenderFormat &format : mFormats) {
-            out.width(3);
-            out << ' ';
-            out << format.name;
-            out << std::endl;
-        }
-    }
-
-    const core::Color RenderMode::DefaultTransparent() const
-    {
-        return core::Color(255, 0, 255, 255);
-    }
-    
-    void RenderMode::SetupPalette(core::Image &image, const core::Palette &palette)
-    {
-        if(core::IsPalettized(image)) {
-            core::Palette copied = palette;
-            image.AttachPalette(copied);
-        }
-    }
-
-    void RenderMode::SetupFormat(core::Image &image, uint32_t format)
-    {
-        if(core::IsPalettized(image)) {
-            if(format != core::ImageFormat(image).format) {
-                image = core::ConvertImage(image, format);
-            }
-        }
+        PrintRenderFormats(out, mFormats);
     }
 
-    void RenderMode::SetupTransparentColor(core::Image &surface, const core::Color &color)
-    {
-        surface.SetColorKey(color);
-    }
-    
     int RenderMode::Exec(const ModeConfig &cfg)
     {
         cfg.verbose << "Reading file " << mInputFile << std::endl;
@@ -105,22 +100,29 @@ namespace gmtool
             throw std::logic_error("Palette index is out of range");
         }
 
-        if(DefaultTransparent() != mTransparentColor) {
+        if(DefaultTransparentColor() != mTransparentColor) {
             cfg.verbose << "Use transparent: " << mTransparentColor << std::endl;
             reader.SetTransparentColor(mTransparentColor);
         }
+
+        if(!cfg.cacheDir.empty()) {
+            cfg.verbose << "Use cache directory " << cfg.cacheDir << std::endl;
+            reader.SetCacheDirectory(cfg.cacheDir);
+        }
         
         core::Image entry = reader.ReadEntry(mEntryIndex);
 
         std::ostream *out = nullptr;
 
+        // Image to be piped is rendered in memory first and written at once
+        const bool toStdout = (mOutputFile == "-");
         std::ostringstream dummy;
-        if(mEvalSizeOnly) {
+        if(mEvalSizeOnly || toStdout) {
             out = &dummy;
         }
 
         boost::filesystem::ofstream fout;
-        if(!mEvalSizeOnly) {
+        if(!mEvalSizeOnly && !toStdout) {
             if(mOutputFile.empty()) {
                 throw std::logic_error("You should specify --output option");
             }
@@ -131,33 +133,27 @@ namespace gmtool
             out = &fout;
         }
         
-        cfg.verbose << "Setting up palette" << std::endl;
-        SetupPalette(entry, reader.Palette(mPaletteIndex));
-        
-        cfg.verbose << "Setting up format" << std::endl;
-        SetupFormat(entry, gm1::PalettePixelFormat);
+        cfg.verbose << "Setting up palette and format" << std::endl;
+        PrepareEntryForRender(entry, reader.Palette(mPaletteIndex));
 
         cfg.verbose << "Setting up transparency" << std::endl;
-        SetupTransparentColor(entry, mTransparentColor);
+        entry.SetColorKey(mTransparentColor);
 
         cfg.verbose << "Find appropriate format" << std::endl;
-        const RenderFormat *result = nullptr;
-        for(const RenderFormat &format : mFormats) {
-            if(format.name == mFormat)
-                result = &format;
-        }
-
-        if(result == nullptr) {
-            throw std::logic_error("No format with such name");
-        }
+        const RenderFormat &result = FindRenderFormat(mFormats, mFormat);
+        result.renderer->SetCompressionLevel(mCompressionLevel);
 
         cfg.verbose << "Do render" << std::endl;
-        result->renderer->RenderToStream(*out, entry);
+        result.renderer->RenderToStream(*out, entry);
 
         if(mEvalSizeOnly) {
             cfg.verbose << "Printing size" << std::endl;
             out->seekp(0, std::ios_base::end);
             cfg.stdout << out->tellp() << std::endl;
+        } else if(toStdout) {
+            cfg.verbose << "Writing to standard output" << std::endl;
+            const core::RWStats stats = WriteToStandardOutput(cfg.stdout, dummy.str());
+            cfg.verbose << stats.bytesWritten << " bytes in " << stats.numWrites << " writes" << std::endl;
         }
         return EXIT_SUCCESS;
     }
@@ -12,12 +12,6 @@
 
 #include <core/color.h>
 
-namespace core
-{
-    class Image;
-    class Palette;
-}
-
 namespace gmtool
 {
     class RenderFormat;
@@ -32,16 +26,11 @@ namespace gmtool
         std::string mFormat;
         size_t mEntryIndex = 0;
         size_t mPaletteIndex = 0;
+        int mCompressionLevel = -1;
         core::Color mTransparentColor;
         std::vector<RenderFormat> mFormats;
         bool mEvalSizeOnly = false;
 
-        const core::Color DefaultTransparent() const;
-        
-        void SetupFormat(core::Image &surface, uint32_t format);
-        void SetupPalette(core::Image &surface, const core::Palette &palette);
-        void SetupTransparentColor(core::Image &surface, const core::Color &color);
-        
     public:
         RenderMode();
         virtual ~RenderMode() throw();
@@ -0,0 +1,278 @@
+#include "sheetmode.h"
+
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+#include <boost/filesystem/fstream.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <boost/program_options/options_description.hpp>
+#include <boost/program_options/positional_options.hpp>
+
+#include <gmtool/renderer.h>
+
+#include <gm1/gm1.h>
+#include <gm1/gm1reader.h>
+
+#include <core/color.h>
+#include <core/image.h>
+#include <core/imageview.h>
+#include <core/palette.h>
+#include <core/parallel.h>
+#include <core/point.h>
+#include <core/rect.h>
+
+namespace po = boost::program_options;
+
+namespace
+{
+    const core::Color SheetBackground(255, 0, 255, 0);
+
+    struct SheetEntry
+    {
+        size_t index;
+        core::Rect rect;
+        gm1::EntryHeader header;
+    };
+
+    void WriteJSONString(std::ostream &out, const std::string &str)
+    {
+        const char hex[] = "0123456789abcdef";
+
+        out << '"';
+        for(unsigned char c : str) {
+            switch(c) {
+            case '"':  out << "\\\""; break;
+            case '\\': out << "\\\\"; break;
+            case '\b': out << "\\b"; break;
+            case '\f': out << "\\f"; break;
+            case '\n': out << "\\n"; break;
+            case '\r': out << "\\r"; break;
+            case '\t': out << "\\t"; break;
+            default:
+                if(c < 0x20) {
+                    out << "\\u00" << hex[c >> 4] << hex[c & 0xf];
+                } else {
+                    out << c;
+                }
+                break;
+            }
+        }
+        out << '"';
+    }
+
+    void WriteManifestJSON(std::ostream &out, const boost::filesystem::path &image, const core::Image &sheet, const std::vector<SheetEntry> &entries)
+    {
+        out << "{" << std::endl;
+        out << "  \"image\": ";
+        WriteJSONString(out, image.filename().string());
+        out << "," << std::endl;
+        out << "  \"width\": " << sheet.Width() << "," << std::endl;
+        out << "  \"height\": " << sheet.Height() << "," << std::endl;
+        out << "  \"entries\": [";
+        for(size_t i = 0; i < entries.size(); ++i) {
+            const SheetEntry &entry = entries[i];
+            out << ((i == 0) ? "" : ",") << std::endl
+                << "    {"
+                << "\"index\": " << entry.index
+                << ", \"x\": " << entry.rect.X()
+                << ", \"y\": " << entry.rect.Y()
+                << ", \"width\": " << entry.rect.Width()
+                << ", \"height\": " << entry.rect.Height()
+                << ", \"posX\": " << entry.header.posX
+                << ", \"posY\": " << entry.header.posY
+                << ", \"tileY\": " << entry.header.tileY
+                << ", \"hOffset\": " << static_cast<int>(entry.header.hOffset)
+                << ", \"group\": " << static_cast<int>(entry.header.group)
+                << "}";
+        }
+        out << std::endl << "  ]" << std::endl;
+        out << "}" << std::endl;
+    }
+
+    void WriteManifestCSV(std::ostream &out, const std::vector<SheetEntry> &entries)
+    {
+        out << "index,x,y,width,height,posX,posY,tileY,hOffset,group" << std::endl;
+        for(const SheetEntry &entry : entries) {
+            out << entry.index << ','
+                << entry.rect.X() << ','
+                << entry.rect.Y() << ','
+                << entry.rect.Width() << ','
+                << entry.rect.Height() << ','
+                << entry.header.posX << ','
+                << entry.header.posY << ','
+                << entry.header.tileY << ','
+                << static_cast<int>(entry.header.hOffset) << ','
+                << static_cast<int>(entry.header.group)
+                << std::endl;
+        }
+    }
+}
+
+namespace gmtool
+{
+    SheetMode::~SheetMode() throw() = default;
+    SheetMode::SheetMode()
+    {
+        mFormats = RenderFormats();
+    }
+
+    void SheetMode::GetOptions(po::options_description &opts)
+    {
+        po::options_description mode("Sheet mode");
+        mode.add_options()
+            ("file",              po::value(&mInputFile)->required(),                                    "Set GM1 filename")
+            ("output,o",          po::value(&mOutputFile)->required(),                                   "Set output image filename")
+            ("format,f",          po::value(&mFormat)->default_value(mFormats.front().name),             "Set sheet file format")
+            ("compression",       po::value(&mCompressionLevel)->default_value(mCompressionLevel),       "Set compression level 0..9, -1 for format default")
+            ("palette,p",         po::value(&mPaletteIndex),                                             "Set palette index for 8-bit entries")
+            ("group,g",           po::value(&mGroup),                                                    "Take only entries of the group")
+            ("columns",           po::value(&mColumns),                                                  "Set number of columns, square sheet if omitted")
+            ("padding",           po::value(&mPadding)->default_value(mPadding),                         "Set space between entries")
+            ("manifest",          po::value(&mManifestFile),                                             "Set manifest filename, output name with manifest extension if omitted")
+            ("manifest-format",   po::value(&mManifestFormat)->default_value("json"),                    "Set manifest format: json or csv")
+            ("jobs,j",            po::value(&mNumJobs)->default_value(core::HardwareConcurrency()),      "Set number of decoding threads")
+            ;
+        opts.add(mode);
+    }
+
+    void SheetMode::GetPositionalOptions(po::positional_options_description &unnamed)
+    {
+        unnamed.add("file", 1);
+        unnamed.add("output", 1);
+    }
+
+    void SheetMode::PrintUsage(std::ostream &out)
+    {
+        out << "Usage: gmtool sheet <file.gm1> <output image>" << std::endl;
+        out << "Allowed sheet formats are:" << std::endl;
+        PrintRenderFormats(out, mFormats);
+    }
+
+    int SheetMode::Exec(const ModeConfig &cfg)
+    {
+        cfg.verbose << "Find appropriate format" << std::endl;
+        const RenderFormat &result = FindRenderFormat(mFormats, mFormat);
+        result.renderer->SetCompressionLevel(mCompressionLevel);
+
+        if(mManifestFormat != "json" && mManifestFormat != "csv") {
+            throw std::logic_error("Manifest format should be either json or csv");
+        }
+
+        if(mPadding < 0) {
+            throw std::logic_error("Padding should not be negative");
+        }
+
+        if(mNumJobs == 0) {
+            throw std::logic_error("Number of jobs should be positive");
+        }
+
+        cfg.verbose << "Reading file " << mInputFile << std::endl;
+        gm1::GM1Reader reader(mInputFile, gm1::GM1Reader::Mapped);
+
+        if(!cfg.cacheDir.empty()) {
+            cfg.verbose << "Use cache directory " << cfg.cacheDir << std::endl;
+            reader.SetCacheDirectory(cfg.cacheDir);
+        }
+
+        if(mPaletteIndex >= reader.NumPalettes()) {
+            throw std::logic_error("Palette index is out of range");
+        }
+
+        std::vector<size_t> indices;
+        if(mGroup < 0) {
+            for(size_t index = 0; index < reader.NumEntries(); ++index) {
+                indices.push_back(index);
+            }
+        } else {
+            indices = reader.GroupEntries(mGroup);
+        }
+
+        if(indices.empty()) {
+            throw std::logic_error("No entries to put into sheet");
+        }
+
+        cfg.verbose << "Decoding " << indices.size() << " entries using " << mNumJobs << " jobs" << std::endl;
+        std::vector<core::Image> images = reader.ReadEntries(indices, mNumJobs);
+
+        int cellWidth = 0;
+        int cellHeight = 0;
+        for(const core::Image &image : images) {
+            cellWidth = std::max<int>(cellWidth, image.Width());
+            cellHeight = std::max<int>(cellHeight, image.Height());
+        }
+        cellWidth += mPadding;
+        cellHeight += mPadding;
+
+        const size_t columns = (mColumns != 0)
+            ? mColumns
+            : static_cast<size_t>(std::ceil(std::sqrt(static_cast<double>(images.size()))));
+        const size_t rows = (images.size() + columns - 1) / columns;
+
+        const int width = std::max(1, static_cast<int>(columns * cellWidth) - mPadding);
+        const int height = std::max(1, static_cast<int>(rows * cellHeight) - mPadding);
+        cfg.verbose << "Sheet is " << width << "x" << height << " of " << columns << " columns" << std::endl;
+
+        core::Image sheet = core::CreateImage(width, height, SDL_PIXELFORMAT_ARGB8888);
+        core::ClearImage(sheet, SheetBackground);
+        sheet.SetColorKey(SheetBackground);
+
+        // Views share refcounted surfaces, so they are made here and
+        // each thread blits into its own view afterwards.
+        std::vector<SheetEntry> entries(images.size());
+        std::vector<core::Image> views(images.size());
+        for(size_t i = 0; i < images.size(); ++i) {
+            const core::Rect rect(
+                (i % columns) * cellWidth,
+                (i / columns) * cellHeight,
+                images[i].Width(),
+                images[i].Height());
+            entries[i] = SheetEntry {indices[i], rect, reader.EntryHeader(indices[i])};
+            if(!core::RectEmpty(rect)) {
+                views[i] = core::ImageView(sheet, rect).GetView();
+            }
+        }
+
+        const core::Palette &palette = reader.Palette(mPaletteIndex);
+        core::ParallelFor(images.size(), mNumJobs, [&](size_t i) {
+                core::Image &image = images[i];
+                if(views[i].Null()) {
+                    return;
+                }
+
+                PrepareEntryForRender(image, palette);
+                core::CopyImage(image, core::Rect(image.Width(), image.Height()), views[i], core::Point(0, 0));
+            });
+        views.clear();
+
+        boost::filesystem::ofstream fout(mOutputFile, std::ios_base::binary | std::ios_base::out);
+        if(!fout) {
+            throw std::runtime_error(strerror(errno));
+        }
+        result.renderer->RenderToStream(fout, sheet);
+
+        boost::filesystem::path manifestFile = mManifestFile;
+        if(manifestFile.empty()) {
+            manifestFile = mOutputFile;
+            manifestFile.replace_extension(mManifestFormat);
+        }
+
+        cfg.verbose << "Writing manifest " << manifestFile << std::endl;
+        boost::filesystem::ofstream mout(manifestFile, std::ios_base::out);
+        if(!mout) {
+            throw std::runtime_error(strerror(errno));
+        }
+
+        if(mManifestFormat == "json") {
+            WriteManifestJSON(mout, mOutputFile, sheet, entries);
+        } else {
+            WriteManifestCSV(mout, entries);
+        }
+
+        return EXIT_SUCCESS;
+    }
+}
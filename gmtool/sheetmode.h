@@ -0,0 +1,51 @@
+#ifndef SHEETMODE_H_
+#define SHEETMODE_H_
+
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem/path.hpp>
+
+#include <gmtool/mode.h>
+
+namespace gmtool
+{
+    class RenderFormat;
+}
+
+namespace gmtool
+{
+    /**
+     * \brief Lays out entries of a collection into a single image.
+     *
+     * Entries go into a grid of equal cells in order of their indices.
+     * Sheet is accompanied by a manifest with entry rects and anchors.
+     */
+    class SheetMode : public Mode
+    {
+        boost::filesystem::path mInputFile;
+        boost::filesystem::path mOutputFile;
+        boost::filesystem::path mManifestFile;
+        std::string mFormat;
+        std::string mManifestFormat;
+        size_t mPaletteIndex = 0;
+        int mCompressionLevel = -1;
+        int mGroup = -1;
+        size_t mColumns = 0;
+        int mPadding = 1;
+        size_t mNumJobs = 1;
+        std::vector<RenderFormat> mFormats;
+
+    public:
+        SheetMode();
+        virtual ~SheetMode() throw();
+
+        void PrintUsage(std::ostream &out);
+        void GetOptions(boost::program_options::options_description&);
+        void GetPositionalOptions(boost::program_options::positional_options_description&);
+        int Exec(const ModeConfig &config);
+    };
+}
+
+#endif // SHEETMODE_H_
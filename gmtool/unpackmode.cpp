@@ -1,6 +1,126 @@
 #include "unpackmode.h"
 
+#include <cerrno>
+#include <cstring>
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+#include <boost/filesystem/fstream.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <boost/program_options/options_description.hpp>
+#include <boost/program_options/positional_options.hpp>
+
+#include <gmtool/renderer.h>
+
+#include <gm1/gm1.h>
+#include <gm1/gm1reader.h>
+
+#include <core/image.h>
+#include <core/palette.h>
+#include <core/color.h>
+#include <core/parallel.h>
+
+namespace po = boost::program_options;
+
 namespace gmtool
 {
+    UnpackMode::~UnpackMode() throw() = default;
+    UnpackMode::UnpackMode()
+    {
+        mFormats = RenderFormats();
+    }
+
+    void UnpackMode::GetOptions(po::options_description &opts)
+    {
+        po::options_description mode("Unpack mode");
+        mode.add_options()
+            ("file",              po::value(&mInputFile)->required(),                                    "Set GM1 filename")
+            ("output,o",          po::value(&mOutputDir),                                                "Set output directory")
+            ("format,f",          po::value(&mFormat)->default_value(mFormats.front().name),             "Set render file format")
+            ("compression",       po::value(&mCompressionLevel)->default_value(mCompressionLevel),       "Set compression level 0..9, -1 for format default")
+            ("palette,p",         po::value(&mPaletteIndex),                                             "Set palette index for 8-bit entries")
+            ("transparent-color", po::value(&mTransparentColor)->default_value(DefaultTransparentColor()), "Set background color in #AARRGGBB format")
+            ("jobs,j",            po::value(&mNumJobs)->default_value(core::HardwareConcurrency()),      "Set number of rendering threads")
+            ;
+        opts.add(mode);
+    }
+
+    void UnpackMode::GetPositionalOptions(po::positional_options_description &unnamed)
+    {
+        unnamed.add("file", 1);
+        unnamed.add("output", 1);
+    }
+
+    void UnpackMode::PrintUsage(std::ostream &out)
+    {
+        out << "Allowed render formats are:" << std::endl;
+        PrintRenderFormats(out, mFormats);
+    }
+
+    const boost::filesystem::path UnpackMode::EntryPath(size_t index, const std::string &format) const
+    {
+        std::ostringstream oss;
+        oss << std::setw(5) << std::setfill('0') << index << '.' << format;
+        return mOutputDir / oss.str();
+    }
+
+    int UnpackMode::Exec(const ModeConfig &cfg)
+    {
+        cfg.verbose << "Reading file " << mInputFile << std::endl;
+        gm1::GM1Reader reader(mInputFile, gm1::GM1Reader::Mapped);
+
+        cfg.verbose << "Collection contains " << reader.NumEntries() << " entries" << std::endl;
+
+        if(mPaletteIndex >= reader.NumPalettes()) {
+            throw std::logic_error("Palette index is out of range");
+        }
+
+        if(mOutputDir.empty()) {
+            throw std::logic_error("You should specify --output option");
+        }
+
+        if(mNumJobs == 0) {
+            throw std::logic_error("Number of jobs should be positive");
+        }
+
+        if(DefaultTransparentColor() != mTransparentColor) {
+            cfg.verbose << "Use transparent: " << mTransparentColor << std::endl;
+            reader.SetTransparentColor(mTransparentColor);
+        }
+
+        if(!cfg.cacheDir.empty()) {
+            cfg.verbose << "Use cache directory " << cfg.cacheDir << std::endl;
+            reader.SetCacheDirectory(cfg.cacheDir);
+        }
+
+        cfg.verbose << "Find appropriate format" << std::endl;
+        const RenderFormat &result = FindRenderFormat(mFormats, mFormat);
+        result.renderer->SetCompressionLevel(mCompressionLevel);
+
+        if(!boost::filesystem::exists(mOutputDir)) {
+            cfg.verbose << "Create directory " << mOutputDir << std::endl;
+            boost::filesystem::create_directories(mOutputDir);
+        }
+
+        cfg.verbose << "Unpacking into " << mOutputDir << " using " << mNumJobs << " jobs" << std::endl;
+        const core::Palette &palette = reader.Palette(mPaletteIndex);
+
+        core::ParallelFor(reader.NumEntries(), mNumJobs, [&](size_t index) {
+                core::Image entry = reader.ReadEntry(index);
+                PrepareEntryForRender(entry, palette);
+                entry.SetColorKey(mTransparentColor);
+
+                boost::filesystem::ofstream fout(EntryPath(index, result.name), std::ios_base::binary | std::ios_base::out);
+                if(!fout) {
+                    throw std::runtime_error(strerror(errno));
+                }
+                result.renderer->RenderToStream(fout, entry);
+            });
 
+        cfg.verbose << reader.NumEntries() << " entries unpacked" << std::endl;
+        return EXIT_SUCCESS;
+    }
 }
@@ -1,10 +1,45 @@
 #ifndef UNPACKMODE_H_
 #define UNPACKMODE_H_
 
-#include "mode.h"
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem/path.hpp>
+
+#include <gmtool/mode.h>
+
+#include <core/color.h>
+
+namespace gmtool
+{
+    class RenderFormat;
+}
 
 namespace gmtool
 {
+    class UnpackMode : public Mode
+    {
+        boost::filesystem::path mInputFile;
+        boost::filesystem::path mOutputDir;
+        std::string mFormat;
+        size_t mPaletteIndex = 0;
+        int mCompressionLevel = -1;
+        size_t mNumJobs = 1;
+        core::Color mTransparentColor;
+        std::vector<RenderFormat> mFormats;
+
+        const boost::filesystem::path EntryPath(size_t index, const std::string &format) const;
+
+    public:
+        UnpackMode();
+        virtual ~UnpackMode() throw();
+
+        void PrintUsage(std::ostream &out);
+        void GetOptions(boost::program_options::options_description&);
+        void GetPositionalOptions(boost::program_options::positional_options_description&);
+        int Exec(const ModeConfig &config);
+    };
 }
 
 #endif // UNPACKMODE_H_
@@ -7,13 +7,24 @@
 #include <algorithm>
 #include <iostream>
 #include <iterator>
+#include <limits>
 #include <sstream>
 #include <stdexcept>
+#include <string>
+#include <vector>
 
 #include <core/color.h>
 #include <core/image.h>
 #include <core/imagelocker.h>
 #include <core/iohelpers.h>
+#include <core/rlesprite.h>
+
+#if defined(__SSE2__)
+#define TGX_ENCODE_SSE2 1
+#include <emmintrin.h>
+#else
+#define TGX_ENCODE_SSE2 0
+#endif
 
 namespace
 {
@@ -35,6 +46,8 @@ namespace
 
     const int MaxTokenLength = 32;
 
+    const size_t ReadChunkBytes = 1 << 16;
+
     constexpr int ExtractTokenLength(token_t token)
     {
         return (token & 0x1f) + 1;
@@ -147,6 +160,278 @@ namespace
 
         return out;
     }
+
+    /**
+       \brief Run scanning for 8-bit and 16-bit pixels.
+
+       Pixels are compared by value instead of bytewise and whole vectors
+       of pixels are checked at once. Tokens of the line are gathered into
+       a buffer which is written out at the line feed.
+    **/
+    template<class Pixel>
+    class LineScanner
+    {
+        const Pixel mColorKey;
+        const bool mKeyed;
+
+    public:
+        LineScanner(Pixel colorKey, bool keyed)
+            : mColorKey(colorKey)
+            , mKeyed(keyed)
+            {}
+
+        inline bool Transparent(Pixel pixel) const {
+            return mKeyed && (pixel == mColorKey);
+        }
+
+        /** Number of leading pixels equal to value **/
+        size_t CountEqual(const Pixel *pixels, size_t count, Pixel value) const;
+
+        /** Number of leading non-transparent pixels which differ from their left neighbour **/
+        size_t CountDistinct(const Pixel *pixels, size_t count) const;
+    };
+
+#if TGX_ENCODE_SSE2
+    inline __m128i Broadcast(uint8_t value)
+    {
+        return _mm_set1_epi8(value);
+    }
+
+    inline __m128i Broadcast(uint16_t value)
+    {
+        return _mm_set1_epi16(value);
+    }
+
+    inline __m128i CompareEqual(__m128i lhs, __m128i rhs, uint8_t)
+    {
+        return _mm_cmpeq_epi8(lhs, rhs);
+    }
+
+    inline __m128i CompareEqual(__m128i lhs, __m128i rhs, uint16_t)
+    {
+        return _mm_cmpeq_epi16(lhs, rhs);
+    }
+
+    template<class Pixel>
+    inline __m128i LoadPixels(const Pixel *pixels)
+    {
+        return _mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels));
+    }
+#endif
+
+    template<class Pixel>
+    size_t LineScanner<Pixel>::CountEqual(const Pixel *pixels, size_t count, Pixel value) const
+    {
+        size_t i = 0;
+#if TGX_ENCODE_SSE2
+        const size_t lanes = sizeof(__m128i) / sizeof(Pixel);
+        const __m128i values = Broadcast(value);
+        for(; i + lanes <= count; i += lanes) {
+            const int mask = _mm_movemask_epi8(CompareEqual(LoadPixels(pixels + i), values, Pixel()));
+            if(mask != 0xffff) {
+                return i + __builtin_ctz(~mask) / sizeof(Pixel);
+            }
+        }
+#endif
+        while((i < count) && (pixels[i] == value)) {
+            ++i;
+        }
+        return i;
+    }
+
+    template<class Pixel>
+    size_t LineScanner<Pixel>::CountDistinct(const Pixel *pixels, size_t count) const
+    {
+        if((count == 0) || Transparent(pixels[0])) {
+            return 0;
+        }
+
+        size_t i = 1;
+#if TGX_ENCODE_SSE2
+        const size_t lanes = sizeof(__m128i) / sizeof(Pixel);
+        const __m128i colorKey = Broadcast(mColorKey);
+        const __m128i keyMask = mKeyed ? _mm_set1_epi8(-1) : _mm_setzero_si128();
+        for(; i + lanes <= count; i += lanes) {
+            const __m128i current = LoadPixels(pixels + i);
+            const __m128i repeated = CompareEqual(current, LoadPixels(pixels + i - 1), Pixel());
+            const __m128i transparent = _mm_and_si128(CompareEqual(current, colorKey, Pixel()), keyMask);
+            const int mask = _mm_movemask_epi8(_mm_or_si128(repeated, transparent));
+            if(mask != 0) {
+                return i + __builtin_ctz(mask) / sizeof(Pixel);
+            }
+        }
+#endif
+        while((i < count) && !Transparent(pixels[i]) && (pixels[i] != pixels[i - 1])) {
+            ++i;
+        }
+        return i;
+    }
+
+    template<class Pixel>
+    inline void AppendToken(std::string &line, token_t token, const Pixel *pixels, size_t numPixels)
+    {
+        line.push_back(static_cast<char>(token));
+        line.append(reinterpret_cast<const char*>(pixels), numPixels * sizeof(Pixel));
+    }
+
+    /**
+       Produces exactly the same tokens as tgx::EncodeLine does.
+    **/
+    template<class Pixel>
+    void EncodeLineFast(std::string &line, const Pixel *pixels, size_t width, const LineScanner<Pixel> &scanner)
+    {
+        const Pixel *const end = pixels + width;
+
+        while(pixels != end) {
+            const size_t available = std::min<size_t>(end - pixels, MaxTokenLength);
+
+            /** Grab all transparent pixels **/
+            if(scanner.Transparent(*pixels)) {
+                const size_t count = scanner.CountEqual(pixels, available, *pixels);
+                line.push_back(static_cast<char>(MakeTransparentToken(count)));
+                pixels += count;
+                continue;
+            }
+
+            /** Grab two or more repeating pixels **/
+            const size_t repeat = scanner.CountEqual(pixels, available, *pixels);
+            if(repeat > 1) {
+                AppendToken(line, MakeRepeatToken(repeat), pixels, 1);
+                pixels += repeat;
+                continue;
+            }
+
+            /** Grab all the rest leaving the beginning of the next repeat out **/
+            size_t stream = scanner.CountDistinct(pixels, available);
+            if((pixels + stream != end) && (pixels[stream] == pixels[stream - 1])) {
+                --stream;
+            }
+            AppendToken(line, MakeStreamToken(stream), pixels, stream);
+            pixels += stream;
+        }
+
+        line.push_back(static_cast<char>(MakeLineFeedToken()));
+    }
+
+    template<class Pixel>
+    std::ostream& EncodeBufferFast(std::ostream &out, const char *pixels, size_t width, size_t height, size_t rowStride, uint32_t colorKey, bool keyed)
+    {
+        const LineScanner<Pixel> scanner(colorKey, keyed);
+
+        std::string line;
+        for(size_t y = 0; y < height; ++y) {
+            line.clear();
+            EncodeLineFast(line, reinterpret_cast<const Pixel*>(pixels + rowStride * y), width, scanner);
+            if(!out.write(line.data(), line.size())) {
+                return out;
+            }
+        }
+
+        return out;
+    }
+    /**
+       \brief Minimum-size tokenization of a line.
+
+       Cost of position i is the least number of bytes needed to encode
+       pixels from i up to the end of the line. Positions are evaluated
+       from right to left, each one tries every token that fits there.
+    **/
+    class OptimalLineEncoder
+    {
+        struct Step
+        {
+            size_t cost;
+            TokenType type;
+            size_t length;
+        };
+
+        std::vector<Step> mSteps;
+
+        inline void Consider(size_t pos, TokenType type, size_t length, size_t tokenBytes);
+
+    public:
+        void Encode(std::string &line, const char *pixels, size_t width, size_t bytesPP, uint32_t colorKey, bool keyed);
+    };
+
+    inline void OptimalLineEncoder::Consider(size_t pos, TokenType type, size_t length, size_t tokenBytes)
+    {
+        const size_t cost = tokenBytes + mSteps[pos + length].cost;
+        if(cost < mSteps[pos].cost) {
+            mSteps[pos] = Step {cost, type, length};
+        }
+    }
+
+    void OptimalLineEncoder::Encode(std::string &line, const char *pixels, size_t width, size_t bytesPP, uint32_t colorKey, bool keyed)
+    {
+        mSteps.assign(width + 1, Step {0, TokenType::Stream, 0});
+
+        // Lengths of transparent, opaque and same-pixel runs starting at the position
+        size_t transparentRun = 0;
+        size_t opaqueRun = 0;
+        size_t equalRun = 0;
+
+        for(size_t i = width; i-- > 0; ) {
+            const char *pixel = pixels + i * bytesPP;
+            mSteps[i].cost = std::numeric_limits<size_t>::max();
+
+            if(keyed && PixelTransparent(pixel, colorKey, bytesPP)) {
+                ++transparentRun;
+                opaqueRun = 0;
+                equalRun = 0;
+
+                for(size_t length = std::min<size_t>(transparentRun, MaxTokenLength); length > 0; --length) {
+                    Consider(i, TokenType::Transparent, length, 1);
+                }
+            } else {
+                const bool repeats = (opaqueRun > 0) && PixelsEqual(pixel, pixel + bytesPP, bytesPP);
+                equalRun = repeats ? equalRun + 1 : 1;
+                ++opaqueRun;
+                transparentRun = 0;
+
+                for(size_t length = std::min<size_t>(equalRun, MaxTokenLength); length > 1; --length) {
+                    Consider(i, TokenType::Repeat, length, 1 + bytesPP);
+                }
+                for(size_t length = std::min<size_t>(opaqueRun, MaxTokenLength); length > 0; --length) {
+                    Consider(i, TokenType::Stream, length, 1 + length * bytesPP);
+                }
+            }
+        }
+
+        for(size_t i = 0; i < width; i += mSteps[i].length) {
+            const Step &step = mSteps[i];
+            const char *pixel = pixels + i * bytesPP;
+            line.push_back(static_cast<char>(MakeToken(step.type, step.length)));
+
+            switch(step.type) {
+            case TokenType::Stream:
+                line.append(pixel, step.length * bytesPP);
+                break;
+            case TokenType::Repeat:
+                line.append(pixel, bytesPP);
+                break;
+            default:
+                break;
+            }
+        }
+
+        line.push_back(static_cast<char>(MakeLineFeedToken()));
+    }
+
+    std::ostream& EncodeBufferOptimal(std::ostream &out, const char *pixels, size_t width, size_t height, size_t rowStride, size_t bytesPP, uint32_t colorKey, bool keyed)
+    {
+        OptimalLineEncoder encoder;
+
+        std::string line;
+        for(size_t y = 0; y < height; ++y) {
+            line.clear();
+            encoder.Encode(line, pixels + rowStride * y, width, bytesPP, colorKey, keyed);
+            if(!out.write(line.data(), line.size())) {
+                return out;
+            }
+        }
+
+        return out;
+    }
 }
 
 namespace tgx
@@ -204,27 +489,30 @@ namespace tgx
         return WriteLineFeed(out);
     }    
 
-    std::ostream& EncodeImage(std::ostream &out, const core::Image &image)
+    /**
+       Pixels of 8 and 16 bits are handled by the specialized encoder.
+    **/
+    std::ostream& EncodeRows(std::ostream &out, const char *pixels, size_t width, size_t height, size_t rowStride, size_t bytesPP, uint32_t colorKey, bool keyed, Encoding encoding)
     {
-        const core::ImageLocker lock(image);
-        
-        const char *data = lock.Data();
-        const auto pixelStride = image.PixelStride();
-        const auto rowStride = image.RowStride();
-
-        std::function<bool(const char*)> transparencyPredicate = [](const char *pixel) {
-            return false;
-        };
+        if(encoding == Encoding::Optimal) {
+            return EncodeBufferOptimal(out, pixels, width, height, rowStride, bytesPP, colorKey, keyed);
+        }
 
-        if(image.ColorKeyEnabled()) {
-            const uint32_t colorKey = image.GetColorKey().ConvertTo(core::ImageFormat(image));
-            transparencyPredicate = [pixelStride, colorKey](const char *pixel) {
-                return PixelTransparent(pixel, colorKey, pixelStride);
-            };
+        switch(bytesPP) {
+        case sizeof(uint8_t):
+            return EncodeBufferFast<uint8_t>(out, pixels, width, height, rowStride, colorKey, keyed && (colorKey <= UINT8_MAX));
+        case sizeof(uint16_t):
+            return EncodeBufferFast<uint16_t>(out, pixels, width, height, rowStride, colorKey, keyed && (colorKey <= UINT16_MAX));
+        default:
+            break;
         }
 
-        for(size_t y = 0; y < image.Height(); ++y) {
-            EncodeLine(out, data + rowStride * y, image.Width(), pixelStride, transparencyPredicate);
+        auto transparencyPredicate = [bytesPP, colorKey, keyed](const char *pixel) {
+            return keyed && PixelTransparent(pixel, colorKey, bytesPP);
+        };
+
+        for(size_t y = 0; y < height; ++y) {
+            EncodeLine(out, pixels + rowStride * y, width, bytesPP, transparencyPredicate);
             if(!out) {
                 return out;
             }
@@ -232,14 +520,35 @@ namespace tgx
             
         return out;
     }
+
+    std::ostream& EncodeBuffer(std::ostream &out, const char *pixels, size_t width, size_t height, size_t rowStride, size_t bytesPP, uint32_t colorKey, Encoding encoding)
+    {
+        return EncodeRows(out, pixels, width, height, rowStride, bytesPP, colorKey, true, encoding);
+    }
     
-    std::ostream& WriteImage(std::ostream &out, const core::Image &surface)
+    std::ostream& EncodeImage(std::ostream &out, const core::Image &image, Encoding encoding)
+    {
+        const core::ImageLocker lock(image);
+        
+        const char *data = lock.Data();
+        const auto pixelStride = image.PixelStride();
+        const auto rowStride = image.RowStride();
+
+        uint32_t colorKey = 0;
+        if(image.ColorKeyEnabled()) {
+            colorKey = image.GetColorKey().ConvertTo(core::ImageFormat(image));
+        }
+
+        return EncodeRows(out, data, image.Width(), image.Height(), rowStride, pixelStride, colorKey, image.ColorKeyEnabled(), encoding);
+    }
+    
+    std::ostream& WriteImage(std::ostream &out, const core::Image &surface, Encoding encoding)
     {
         Header header;
         header.width = surface.Width();
         header.height = surface.Height();
         WriteHeader(out, header);
-        return EncodeImage(out, surface);
+        return EncodeImage(out, surface, encoding);
     }
     
     const core::Image ReadImage(std::istream &in)
@@ -249,30 +558,38 @@ namespace tgx
             throw std::runtime_error(strerror(errno));
         }
 
-        const std::streampos origin = in.tellg();
-        in.seekg(0, std::ios_base::end);
-        const std::streampos fsize = in.tellg();
-        in.seekg(origin);
-
         core::Image surface = CreateCompatibleImage(header.width, header.height);
-        tgx::DecodeImage(in, fsize - origin, surface);
+        core::ImageLocker lock(surface);
+
+        const size_t rowBytes = surface.Width() * surface.PixelStride();
+        StreamDecoder decoder(surface.Width(), surface.Height(), surface.PixelStride(), 0,
+                              [&surface, &lock, rowBytes](size_t y, const char *pixels, const std::vector<Span>&) {
+                                  std::copy(pixels, pixels + rowBytes, lock.Data() + surface.RowStride() * y);
+                              });
+
+        // Truncated data leaves the rest of the image blank as DecodeImage does
+        std::vector<char> chunk(ReadChunkBytes);
+        while(!decoder.Done()) {
+            in.read(chunk.data(), chunk.size());
+            if(in.gcount() == 0) {
+                break;
+            }
+            decoder.Feed(chunk.data(), in.gcount());
+        }
         
         return surface;
     }
 
-    std::istream& DecodeLine(std::istream &in, size_t numBytes, char *data, size_t width, size_t bytesPerPixel)
+    const char* DecodeLine(const char *first, const char *last, char *data, size_t width, size_t bytesPerPixel)
     {
-        const std::streampos endPos = numBytes + in.tellg();
         const char *const dataEnd = data + width * bytesPerPixel;
         
-        while(in.tellg() < endPos) {
-            token_t token;
-            core::ReadLittle(in, token);
-            // \note any io errors are just ignored if token has valid TokenType
-            // but we handle them latter anyway
+        while(first != last) {
+            const token_t token = *first++;
 
             const TokenType type = ExtractTokenType(token);
-            const int length = ExtractTokenLength(token);
+            const size_t length = ExtractTokenLength(token);
+            const size_t numBytes = length * bytesPerPixel;
             
             switch(type) {
             case TokenType::Repeat:
@@ -282,7 +599,7 @@ namespace tgx
                     // \todo what if new dst value is equal to dstEnd? In that case
                     // we have no space for placing LineFeed. It is certainly an erroneous behavior.
                     // Should we report it here?
-                    if(data + length * bytesPerPixel > dataEnd) {
+                    if(numBytes > static_cast<size_t>(dataEnd - data)) {
                         throw std::overflow_error("token length exceeds available buffer size");
                     }
                 }
@@ -296,22 +613,29 @@ namespace tgx
                     if(length != 1) {
                         throw std::logic_error("inconsistent line break");
                     }
-                    return in;
+                    return first;
                 }
                 break;
                 
             case TokenType::Repeat:
                 {
-                    in.read(data, bytesPerPixel);
-                    for(int n = 0; n < length; ++n) {
-                        std::copy(data, data + bytesPerPixel, data + n * bytesPerPixel);
+                    if(bytesPerPixel > static_cast<size_t>(last - first)) {
+                        throw std::runtime_error("unexpected end of tgx data");
+                    }
+                    for(size_t n = 0; n < length; ++n) {
+                        std::copy(first, first + bytesPerPixel, data + n * bytesPerPixel);
                     }
+                    first += bytesPerPixel;
                 }
                 break;
                 
             case TokenType::Stream:
                 {
-                    in.read(data, length * bytesPerPixel);
+                    if(numBytes > static_cast<size_t>(last - first)) {
+                        throw std::runtime_error("unexpected end of tgx data");
+                    }
+                    std::copy(first, first + numBytes, data);
+                    first += numBytes;
                 }
                 break;
                 
@@ -319,52 +643,264 @@ namespace tgx
                 break;
                 
             default:
-                {
-                    if(!in) {
-                        throw std::runtime_error(strerror(errno));
-                    }
-                    throw std::logic_error("unknown tgx token type");
-                }
+                throw std::logic_error("unknown tgx token type");
             }
 
-            if(!in) {
-                throw std::runtime_error(strerror(errno));
-            }
-            
-            data += length * bytesPerPixel;
+            data += numBytes;
         }
         
-        return in;
+        return first;
     }
-    
-    std::istream& DecodeImage(std::istream &in, size_t numBytes, core::Image &image)
+
+    size_t DecodeBuffer(const char *data, size_t numBytes, char *pixels, size_t width, size_t height, size_t rowStride, size_t bytesPerPixel)
+    {
+        const char *first = data;
+        const char *const last = data + numBytes;
+        
+        for(size_t y = 0; (y < height) && (first != last); ++y) {
+            first = DecodeLine(first, last, pixels + rowStride * y, width, bytesPerPixel);
+        }
+
+        return std::distance(data, first);
+    }
+
+    size_t DecodeImage(const char *data, size_t numBytes, core::Image &image)
     {
         core::ImageLocker lock(image);
+        return DecodeBuffer(data, numBytes, lock.Data(), image.Width(), image.Height(), image.RowStride(), image.PixelStride());
+    }
+    
+    const core::RleSprite DecodeSprite(const char *data, size_t numBytes, size_t width, size_t height, uint32_t format)
+    {
+        core::RleSprite sprite(width, height, format);
+        const size_t bytesPP = sprite.PixelStride();
 
-        const int width = image.Width();
-        const int height = image.Height();
-        const int pixelStride = image.PixelStride();
-        const int rowStride = image.RowStride();
+        // Good estimate unless there are a lot of long repeats
+        sprite.Reserve(numBytes / bytesPP);
 
-        const std::streampos endPos = numBytes + in.tellg();
-        
-        char *const data = lock.Data();
+        const char *first = data;
+        const char *const last = data + numBytes;
+        size_t x = 0;
+
+        while((first != last) && (sprite.NumRows() < height)) {
+            const token_t token = *first++;
+            const TokenType type = ExtractTokenType(token);
+            const size_t length = ExtractTokenLength(token);
+
+            switch(type) {
+            case TokenType::LineFeed:
+                if(length != 1) {
+                    throw std::logic_error("inconsistent line break");
+                }
+                sprite.FinishRow();
+                x = 0;
+                continue;
+
+            case TokenType::Repeat:
+                if(bytesPP > static_cast<size_t>(last - first)) {
+                    throw std::runtime_error("unexpected end of tgx data");
+                }
+                sprite.AppendFill(x, length, first);
+                first += bytesPP;
+                break;
 
-        for(int y = 0; y < height; ++y) {
-            if((in) && (in.tellg() < endPos)) {
-                size_t bytesLeft = endPos - in.tellg();
-                DecodeLine(in, bytesLeft, data + rowStride * y, width, pixelStride);
+            case TokenType::Stream:
+                if(length * bytesPP > static_cast<size_t>(last - first)) {
+                    throw std::runtime_error("unexpected end of tgx data");
+                }
+                sprite.AppendSpan(x, length, first);
+                first += length * bytesPP;
+                break;
+
+            case TokenType::Transparent:
+                if(x + length > width) {
+                    throw std::overflow_error("token length exceeds available buffer size");
+                }
+                break;
+
+            default:
+                throw std::logic_error("unknown tgx token type");
             }
+
+            x += length;
         }
 
-        // Make a look that we read all numBytes
-        if(in) {
-            in.seekg(endPos);
+        while(sprite.NumRows() < height) {
+            sprite.FinishRow();
         }
+        return sprite;
+    }
 
+    std::istream& DecodeImage(std::istream &in, size_t numBytes, core::Image &image)
+    {
+        std::vector<char> buffer(numBytes);
+        if(!in.read(buffer.data(), numBytes)) {
+            throw std::runtime_error(strerror(errno));
+        }
+        
+        DecodeImage(buffer.data(), buffer.size(), image);
         return in;
     }
     
+    StreamDecoder::StreamDecoder(size_t width, size_t height, size_t bytesPP, uint32_t colorKey, LineCallback callback)
+        : mWidth(width)
+        , mHeight(height)
+        , mBytesPP(bytesPP)
+        , mColorKey(colorKey)
+        , mCallback(std::move(callback))
+        , mLine(width * bytesPP)
+        , mX(0)
+        , mY(0)
+        , mToken(0)
+        , mHasToken(false)
+    {
+        if(bytesPP < 1 || bytesPP > 4) {
+            throw std::invalid_argument("unsupported bytes per pixel");
+        }
+
+        mPayload.reserve(MaxTokenLength * bytesPP);
+        ClearLine();
+    }
+
+    void StreamDecoder::ClearLine()
+    {
+        for(size_t x = 0; x < mWidth; ++x) {
+            core::SetPackedPixel(&mLine[x * mBytesPP], mColorKey, mBytesPP);
+        }
+        mSpans.clear();
+        mX = 0;
+    }
+
+    void StreamDecoder::ApplyToken(const char *payload)
+    {
+        const TokenType type = ExtractTokenType(mToken);
+        const size_t length = ExtractTokenLength(mToken);
+
+        if(type == TokenType::LineFeed) {
+            mCallback(mY, mLine.data(), mSpans);
+            ++mY;
+            ClearLine();
+            return;
+        }
+
+        char *const pixels = &mLine[mX * mBytesPP];
+        switch(type) {
+        case TokenType::Stream:
+            std::copy(payload, payload + length * mBytesPP, pixels);
+            break;
+
+        case TokenType::Repeat:
+            for(size_t n = 0; n < length; ++n) {
+                std::copy(payload, payload + mBytesPP, pixels + n * mBytesPP);
+            }
+            break;
+
+        default:
+            break;
+        }
+
+        if(type != TokenType::Transparent) {
+            if(!mSpans.empty() && (mSpans.back().x + mSpans.back().length == mX)) {
+                mSpans.back().length += length;
+            } else {
+                mSpans.push_back(Span {mX, length});
+            }
+        }
+
+        mX += length;
+    }
+
+    size_t StreamDecoder::Feed(const char *data, size_t numBytes)
+    {
+        const char *const begin = data;
+        const char *const end = data + numBytes;
+
+        while((data != end) && !Done()) {
+            if(!mHasToken) {
+                mToken = *data++;
+                mHasToken = true;
+                mPayload.clear();
+
+                const TokenType type = ExtractTokenType(mToken);
+                const size_t length = ExtractTokenLength(mToken);
+                switch(type) {
+                case TokenType::LineFeed:
+                    if(length != 1) {
+                        throw std::logic_error("inconsistent line break");
+                    }
+                    break;
+
+                case TokenType::Stream:
+                case TokenType::Repeat:
+                case TokenType::Transparent:
+                    if(length > mWidth - mX) {
+                        throw std::overflow_error("token length exceeds available buffer size");
+                    }
+                    break;
+
+                default:
+                    throw std::logic_error("unknown tgx token type");
+                }
+            }
+
+            size_t payloadSize = 0;
+            switch(ExtractTokenType(mToken)) {
+            case TokenType::Stream:
+                payloadSize = ExtractTokenLength(mToken) * mBytesPP;
+                break;
+            case TokenType::Repeat:
+                payloadSize = mBytesPP;
+                break;
+            default:
+                break;
+            }
+
+            // Whole token is at hand, there is no need to copy it
+            if(mPayload.empty() && static_cast<size_t>(end - data) >= payloadSize) {
+                ApplyToken(data);
+                data += payloadSize;
+                mHasToken = false;
+                continue;
+            }
+
+            const size_t count = std::min<size_t>(payloadSize - mPayload.size(), end - data);
+            mPayload.insert(mPayload.end(), data, data + count);
+            data += count;
+
+            if(mPayload.size() == payloadSize) {
+                ApplyToken(mPayload.data());
+                mHasToken = false;
+            }
+        }
+
+        return std::distance(begin, data);
+    }
+
+    void StreamDecoder::Finish() const
+    {
+        if(!Done()) {
+            throw std::runtime_error("unexpected end of tgx data");
+        }
+    }
+
+    bool StreamDecoder::Done() const
+    {
+        return mY == mHeight;
+    }
+
+    void StreamDecoder::Reset()
+    {
+        mY = 0;
+        mHasToken = false;
+        mPayload.clear();
+        ClearLine();
+    }
+
+    size_t StreamDecoder::NumLines() const
+    {
+        return mY;
+    }
+
     std::istream& ReadImageHeader(std::istream &in, core::Image &surface)
     {
         Header header;
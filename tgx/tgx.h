@@ -3,8 +3,11 @@
 
 #include <SDL.h>
 
+#include <cstddef>
 #include <cstdint>
+#include <functional>
 #include <iosfwd>
+#include <vector>
 
 /**
  * tgx is a RLE-like compression algorithm.
@@ -44,6 +47,7 @@
 namespace core
 {
     class Image;
+    class RleSprite;
 }
 
 namespace tgx
@@ -76,30 +80,157 @@ namespace tgx
     **/
 
     constexpr uint32_t PixelFormat = SDL_PIXELFORMAT_RGB555;
+
+    /**
+     * \brief How the encoder splits lines into tokens.
+     *
+     * Greedy is a single pass which produces files like original ones.
+     * Optimal picks the token sequence of minimum size for each line,
+     * it is an order of magnitude slower.
+     **/
+    enum class Encoding
+    {
+        Greedy,
+        Optimal
+    };
     
     std::istream& DecodeImage(std::istream&, size_t numBytes, core::Image &surface);
 
+    /**
+     * \brief Low level tgx-decoding function.
+     *
+     * \param data          Input buffer.
+     * \param numBytes      Input buffer size in bytes.
+     * \param pixels        Output pixels.
+     * \param width         Output width in pixels.
+     * \param height        Output height in pixels.
+     * \param rowStride     Output row size in bytes.
+     * \param bytesPP       Number of bytes per pixel.
+     *
+     * \return Number of bytes consumed from the input buffer.
+     *
+     * \note Transparent pixels are left untouched.
+     **/
+    size_t DecodeBuffer(const char *data, size_t numBytes, char *pixels, size_t width, size_t height, size_t rowStride, size_t bytesPP);
+
+    size_t DecodeImage(const char *data, size_t numBytes, core::Image &surface);
+
+    /**
+     * \brief Decodes tgx data straight into opaque spans.
+     *
+     * Adjacent Stream and Repeat tokens are merged into a single span.
+     * Rows which are missing in the data are left empty.
+     *
+     * \param format        SDL pixel format of tgx pixels.
+     **/
+    const core::RleSprite DecodeSprite(const char *data, size_t numBytes, size_t width, size_t height, uint32_t format);
+
     std::istream& ReadImageHeader(std::istream&, core::Image &surface);
 
     const core::Image ReadImage(std::istream&);
 
+    /**
+     * \brief Run of opaque pixels within a decoded line.
+     **/
+    struct Span
+    {
+        size_t x;
+        size_t length;
+    };
+
+    /**
+     * \brief Incremental tgx-decoder.
+     *
+     * Data can be fed in chunks of arbitrary size, incomplete tokens are
+     * kept until the rest of them arrives. Each line is passed to the callback
+     * as soon as its LineFeed token is seen, so only a single line is kept in memory.
+     * Decoder stops right after the last line, trailing data is left unconsumed.
+     *
+     * The callback receives line index, line pixels and list of opaque spans.
+     * Transparent pixels of the line are set to the color key.
+     *
+     * \code
+     * tgx::StreamDecoder decoder(width, height, 2, colorKey, [&](size_t y, const char *pixels, const std::vector<tgx::Span> &spans) {
+     *         Upload(y, pixels);
+     *     });
+     * while(!decoder.Done() && (source.read(chunk, sizeof(chunk)) || source.gcount() > 0)) {
+     *     decoder.Feed(chunk, source.gcount());
+     * }
+     * decoder.Finish();
+     * \endcode
+     **/
+    class StreamDecoder
+    {
+    public:
+        typedef std::function<void(size_t y, const char *pixels, const std::vector<Span> &spans)> LineCallback;
+
+        StreamDecoder(size_t width, size_t height, size_t bytesPP, uint32_t colorKey, LineCallback callback);
+
+        /**
+         * \brief Decodes the chunk.
+         *
+         * \return Number of bytes consumed, it is less than numBytes
+         * only if the last line was decoded.
+         **/
+        size_t Feed(const char *data, size_t numBytes);
+
+        /**
+         * \brief Checks that all lines were decoded.
+         *
+         * \throw std::runtime_error if input ended prematurely.
+         **/
+        void Finish() const;
+
+        bool Done() const;
+
+        /**
+         * \brief Starts a new image of the same dimensions.
+         **/
+        void Reset();
+
+        size_t NumLines() const;
+
+    private:
+        const size_t mWidth;
+        const size_t mHeight;
+        const size_t mBytesPP;
+        const uint32_t mColorKey;
+        LineCallback mCallback;
+
+        std::vector<char> mLine;
+        std::vector<Span> mSpans;
+        std::vector<char> mPayload;
+        size_t mX;
+        size_t mY;
+        uint8_t mToken;
+        bool mHasToken;
+
+        void ClearLine();
+        void ApplyToken(const char *payload);
+    };
+
     /**
      * \brief Low level tgx-encoding function.
      *
      * \param out           Output stream.
      * \param pixels        Input buffer.
-     * \param width         Buffer size in pixels.
+     * \param width         Buffer width in pixels.
+     * \param height        Buffer height in pixels.
+     * \param rowStride     Buffer row size in bytes.
      * \param bytesPP       Number of bytes per pixel.
      * \param colorKey      Pixel which we would treat as transparent.
+     * \param encoding      Token selection strategy.
      *
-     * \note Input buffer must have real size of width * bytesPerPixel bytes.
+     * \note Input buffer must have real size of height * rowStride bytes.
+     * \note Color key which doesn't fit into bytesPP matches no pixel.
      **/
+    std::ostream& EncodeBuffer(std::ostream &out, const char *pixels, size_t width, size_t height, size_t rowStride, size_t bytesPP, uint32_t colorKey, Encoding encoding = Encoding::Greedy);
     
-    std::ostream& EncodeImage(std::ostream&, const core::Image &surface);
+    std::ostream& EncodeImage(std::ostream&, const core::Image &surface, Encoding encoding = Encoding::Greedy);
 
     std::ostream& WriteImageHeader(std::ostream&, const core::Image &surface);
 
-    std::ostream& WriteImage(std::ostream&, const core::Image &surface);
+    std::ostream& WriteImage(std::ostream&, const core::Image &surface, Encoding encoding = Encoding::Greedy);
 
 } // namespace tgx
 